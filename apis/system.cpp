@@ -2,39 +2,27 @@
 #include "drivers/fs_utils.h"
 #include "model/log.h"
 
-// statics
-double SystemApi::_timeout = 5;
-bool SystemApi::_gc = false;
-bool SystemApi::_bytecode = false;
-int SystemApi::_max_connections = 4;
-
 SystemApi::SystemApi()
     : LuaProxy("system")
 {
-  cadd("allowGC", &SystemApi::allowGC);
-  cadd("timeout", &SystemApi::timeout);
-  cadd("allowBytecode", &SystemApi::allowBytecode);
-}
-
-SystemApi* SystemApi::get()
-{
-  static SystemApi it;
-  return &it;
+  add("allowGC", &SystemApi::allowGC);
+  add("timeout", &SystemApi::timeout);
+  add("allowBytecode", &SystemApi::allowBytecode);
 }
 
 int SystemApi::allowGC(lua_State* lua)
 {
-  return ValuePack::ret(lua, get()->_gc);
+  return ValuePack::ret(lua, _gc);
 }
 
 int SystemApi::timeout(lua_State* lua)
 {
-  return ValuePack::ret(lua, get()->_timeout);
+  return ValuePack::ret(lua, _timeout);
 }
 
 int SystemApi::allowBytecode(lua_State* lua)
 {
-  return ValuePack::ret(lua, get()->_bytecode);
+  return ValuePack::ret(lua, _bytecode);
 }
 
 ////////
@@ -44,9 +32,15 @@ void SystemApi::configure(const Value& settings)
   _bytecode = settings.get("allowBytecode").Or(_bytecode).toBool();
   _gc = settings.get("allowGC").Or(_gc).toBool();
   _max_connections = settings.get("maxTcpConnections").Or(_max_connections).toNumber();
+  _chunk_cache = settings.get("chunkCache").Or(_chunk_cache).toBool();
 }
 
-int SystemApi::max_connections()
+int SystemApi::max_connections() const
 {
   return _max_connections;
 }
+
+bool SystemApi::chunk_cache() const
+{
+  return _chunk_cache;
+}
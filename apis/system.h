@@ -1,24 +1,25 @@
 #pragma once
 #include "model/luaproxy.h"
 
+// system settings are per client, each vm loads its own from its client config
 class SystemApi : public LuaProxy
 {
 public:
-  static SystemApi* get();
+  SystemApi();
 
-  static int timeout(lua_State* lua);
-  static int allowGC(lua_State* lua);
-  static int allowBytecode(lua_State* lua);
+  int timeout(lua_State* lua);
+  int allowGC(lua_State* lua);
+  int allowBytecode(lua_State* lua);
 
-  static int max_connections();
+  int max_connections() const;
+  bool chunk_cache() const;
 
-  static void configure(const Value& settings);
+  void configure(const Value& settings);
 
 private:
-  SystemApi();
-
-  static double _timeout;
-  static bool _gc;
-  static bool _bytecode;
-  static int _max_connections;
+  double _timeout = 5;
+  bool _gc = false;
+  bool _bytecode = false;
+  int _max_connections = 4;
+  bool _chunk_cache = false;
 };
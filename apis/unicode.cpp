@@ -10,7 +10,7 @@ using std::ifstream;
 static const uint32_t end_1_byte = 0x00000080;
 static const uint32_t end_2_byte = 0x00000800;
 static const uint32_t end_3_byte = 0x00010000;
-//static const uint32_t end_4_byte = 0x00200000;
+static const uint32_t end_4_byte = 0x00200000;
 //static const uint32_t end_5_byte = 0x04000000;
 //static const uint32_t end_6_byte = 0x80000000;
 
@@ -52,13 +52,15 @@ UnicodeApi* UnicodeApi::get()
   return &it;
 }
 
+// the host loads the font widths once, before any vm starts
+// they are read-only afterwards and safely shared by every vm in the process
 bool UnicodeApi::configure(const string& fonts_path)
 {
-  font_width.clear();
   if (!fs_utils::read(fonts_path))
     return false;
   ifstream file(fonts_path);
 
+  std::unordered_map<uint32_t, int> widths;
   while (file)
   {
     uint32_t key;
@@ -73,14 +75,15 @@ bool UnicodeApi::configure(const string& fonts_path)
       break;
     }
 
-    font_width[key] = bmp.size() / 32;
+    widths[key] = bmp.size() / 32;
   }
 
   file.close();
 
   // custom overrides
-  font_width[9] = 2;
+  widths[9] = 2;
 
+  font_width = std::move(widths);
   return true;
 }
 
@@ -134,12 +137,17 @@ vector<char> UnicodeApi::upper(const vector<char>& text)
 
 uint32_t UnicodeApi::tocodepoint(const vector<char>& text, const size_t index)
 {
-  size_t end = text.size();
-  if (index >= end)
+  if (index >= text.size())
+    return 0;
+  return tocodepoint(text.data() + index, text.size() - index);
+}
+
+uint32_t UnicodeApi::tocodepoint(const char* text, const size_t open)
+{
+  if (open == 0)
     return 0;
-  size_t open = end - index;
 
-  unsigned char flags = text.at(index);
+  unsigned char flags = text[0];
   uint32_t codepoint = flags;
 
   flags &= (((flags >> 1) & 0x40) | 0xBF);
@@ -155,37 +163,37 @@ uint32_t UnicodeApi::tocodepoint(const vector<char>& text, const size_t index)
   case 0xC0: // 2 bytes
     codepoint = (open < 2) ? 0 :
                              ((set_2_mask & codepoint) << 6) |
-    (continuation_mask & text.at(index + 1));
+    (continuation_mask & text[1]);
     break;
   case 0xE0: // 3 bytes
     codepoint = (open < 3) ? 0 :
                              ((set_3_mask & codepoint) << 12) |
-    ((continuation_mask & text.at(index + 1)) << 6) |
-    (continuation_mask & text.at(index + 2));
+    ((continuation_mask & text[1]) << 6) |
+    (continuation_mask & text[2]);
     break;
   case 0xF0: // 4 bytes
     codepoint = (open < 4) ? 0 :
                              ((set_4_mask & codepoint) << 18) |
-    ((continuation_mask & text.at(index + 1)) << 12) |
-    ((continuation_mask & text.at(index + 2)) << 6) |
-    (continuation_mask & text.at(index + 3));
+    ((continuation_mask & text[1]) << 12) |
+    ((continuation_mask & text[2]) << 6) |
+    (continuation_mask & text[3]);
     break;
   case 0xF8: // 5 bytes
     codepoint = (open < 5) ? 0 :
                              ((set_5_mask & codepoint) << 24) |
-    ((continuation_mask & text.at(index + 1)) << 18) |
-    ((continuation_mask & text.at(index + 2)) << 12) |
-    ((continuation_mask & text.at(index + 3)) << 6) |
-    (continuation_mask & text.at(index + 4));
+    ((continuation_mask & text[1]) << 18) |
+    ((continuation_mask & text[2]) << 12) |
+    ((continuation_mask & text[3]) << 6) |
+    (continuation_mask & text[4]);
     break;
   case 0xFC: // 6 bytes
     codepoint = (open < 6) ? 0 :
                              ((set_6_mask & codepoint) << 30) |
-    ((continuation_mask & text.at(index + 1)) << 24) |
-    ((continuation_mask & text.at(index + 2)) << 18) |
-    ((continuation_mask & text.at(index + 3)) << 12) |
-    ((continuation_mask & text.at(index + 4)) << 6) |
-    (continuation_mask & text.at(index + 5));
+    ((continuation_mask & text[1]) << 24) |
+    ((continuation_mask & text[2]) << 18) |
+    ((continuation_mask & text[3]) << 12) |
+    ((continuation_mask & text[4]) << 6) |
+    (continuation_mask & text[5]);
     break;
     //default: // invalid, continuation bit, or ascii
   }
@@ -250,6 +258,39 @@ vector<char> UnicodeApi::tochar(const uint32_t codepoint32)
   return buffer;
 }
 
+size_t UnicodeApi::toutf8(const uint32_t codepoint, char* buffer)
+{
+  // unlike tochar, this keeps the codepoint as is, it is used to re-encode text that was already valid
+  if (codepoint < end_1_byte)
+  {
+    buffer[0] = codepoint;
+    return 1;
+  }
+  else if (codepoint < end_2_byte)
+  {
+    buffer[0] = set_2_bytes_bits | (set_2_mask & codepoint >> 6);
+    buffer[1] = continuation_bit | (continuation_mask & codepoint);
+    return 2;
+  }
+  else if (codepoint < end_3_byte)
+  {
+    buffer[0] = set_3_bytes_bits | (set_3_mask & codepoint >> 12);
+    buffer[1] = continuation_bit | (continuation_mask & codepoint >> 6);
+    buffer[2] = continuation_bit | (continuation_mask & codepoint);
+    return 3;
+  }
+  else if (codepoint < end_4_byte)
+  {
+    buffer[0] = set_4_bytes_bits | (set_4_mask & codepoint >> 18);
+    buffer[1] = continuation_bit | (continuation_mask & codepoint >> 12);
+    buffer[2] = continuation_bit | (continuation_mask & codepoint >> 6);
+    buffer[3] = continuation_bit | (continuation_mask & codepoint);
+    return 4;
+  }
+
+  return toutf8(0xFFFD, buffer);
+}
+
 size_t UnicodeApi::wlen(const vector<char>& text)
 {
   size_t width = 0;
@@ -317,7 +358,11 @@ vector<char> UnicodeApi::sub(const vector<char>& text, int from, int to)
 
 int UnicodeApi::charWidth(const vector<char>& text, bool bAlreadySingle)
 {
-  uint32_t codepoint = UnicodeApi::tocodepoint(bAlreadySingle ? text : UnicodeApi::sub(text, 1, 1));
+  return charWidth(UnicodeApi::tocodepoint(bAlreadySingle ? text : UnicodeApi::sub(text, 1, 1)));
+}
+
+int UnicodeApi::charWidth(const uint32_t codepoint)
+{
   const auto& it = font_width.find(codepoint);
   if (it == font_width.end())
     return 1;
@@ -413,6 +458,11 @@ UnicodeIterator UnicodeApi::subs(const vector<char>& src)
   return UnicodeIterator{ src.data(), src.size() };
 }
 
+UnicodeIterator UnicodeApi::subs(const char* src, const size_t size)
+{
+  return UnicodeIterator{ src, size };
+}
+
 bool UnicodeIterator::UnicodeIt::operator!=(const UnicodeIterator::UnicodeIt& other) const
 {
   return start != other.start;
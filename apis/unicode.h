@@ -30,16 +30,21 @@ class UnicodeApi : public LuaProxy
 public:
   static UnicodeApi* get();
   static UnicodeIterator subs(const vector<char>& src);
+  static UnicodeIterator subs(const char* src, const size_t size);
 
   static vector<char> wtrunc(const vector<char>& text, const size_t width);
   static bool isWide(const vector<char>& text);
   static vector<char> upper(const vector<char>& text);
   static vector<char> tochar(const uint32_t n);
   static uint32_t tocodepoint(const vector<char>& text, const size_t index = 0);
+  static uint32_t tocodepoint(const char* text, const size_t size);
+  // writes codepoint as utf8 to buffer (which must hold 4 bytes), returns the byte count
+  static size_t toutf8(const uint32_t codepoint, char* buffer);
   static size_t wlen(const vector<char>& text);
   static size_t len(const vector<char>& text);
   static vector<char> sub(const vector<char>& text, int from, int to);
   static int charWidth(const vector<char>& text, bool bAlreadySingle = false);
+  static int charWidth(const uint32_t codepoint);
   static vector<char> reverse(const vector<char>& text);
   static vector<char> lower(const vector<char>& text);
 
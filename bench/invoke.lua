@@ -0,0 +1,31 @@
+-- component.invoke throughput benchmark
+-- run it in place of machine.lua, results are printed to the env log
+--   ocvm bench_env --machine=bench/invoke.lua --frame=headless && grep vm bench_env/log
+local iterations = 200000
+
+local function first(filter)
+  for address in pairs(component.list(filter, true)) do
+    return address
+  end
+end
+
+local function bench(name, address, method, ...)
+  if not address then
+    print(name .. ": no component")
+    return
+  end
+  local start = os.clock()
+  for _ = 1, iterations do
+    component.invoke(address, method, ...)
+  end
+  local elapsed = os.clock() - start
+  print(string.format("%-28s %12.0f invokes/s", name, iterations / elapsed))
+end
+
+bench("computer.isRunning", first("computer"), "isRunning")
+bench("eeprom.getLabel", first("eeprom"), "getLabel")
+bench("gpu.getResolution", first("gpu"), "getResolution")
+bench("screen.isOn", first("screen"), "isOn")
+
+-- a missing component takes the uncached path every time
+bench("(no such component)", "00000000-0000-0000-0000-000000000000", "getLabel")
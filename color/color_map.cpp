@@ -1,11 +1,9 @@
 #include "color_map.h"
 #include <algorithm>
+#include <cstdint>
 #include <cstring>
-#include <limits>
 #include <tuple>
 
-static int monochrome_color = 0xffffff;
-
 enum CShift
 {
   RShift32 = 16,
@@ -31,12 +29,12 @@ public:
 class ColorFormat_1 : public ColorFormat
 {
 public:
-  int inflate(const ColorState&, int value) const override
+  int inflate(const ColorState& state, int value) const override
   {
     if (value == 0)
       return 0;
     else
-      return monochrome_color;
+      return state.monochrome;
   }
 
   int deflate(const ColorState& state, const Color& color) const override
@@ -61,6 +59,8 @@ static inline constexpr bool isFromPalette(int value)
   return value >= 0 && value <= (int)ColorState::PALETTE_SIZE;
 }
 
+// luma weighted square distance, the weights are scaled to integers so the
+// distance to every palette entry can be computed in parallel
 static inline constexpr int delta(int a, int b)
 {
   int rA = (a >> CShift::RShift32) & 0xff;
@@ -75,7 +75,7 @@ static inline constexpr int delta(int a, int b)
   int dg = gA - gB;
   int db = bA - bB;
 
-  return 0.2126 * dr * dr + 0.7152 * dg * dg + 0.0722 * db * db;
+  return (2126 * dr * dr + 7152 * dg * dg + 722 * db * db) / 10000;
 }
 
 int deflate(const ColorState& state, const Color& color) const override
@@ -86,18 +86,18 @@ int deflate(const ColorState& state, const Color& color) const override
   }
 
   // search for palette entry with smallest distance from color
-  int min_distance = std::numeric_limits<int>::max();
-  size_t best_index = 0;
+  // all distances first, the loop has no dependencies between entries and vectorizes
+  int distances[ColorState::PALETTE_SIZE];
+  for (size_t i = 0; i < ColorState::PALETTE_SIZE; i++)
+  {
+    distances[i] = delta(state.palette[i], color.rgb);
+  }
 
-  for (size_t i = 0; i < ColorState::PALETTE_SIZE && min_distance > 0; i++)
+  size_t best_index = 0;
+  for (size_t i = 1; i < ColorState::PALETTE_SIZE; i++)
   {
-    const int& palette_entry = state.palette[i];
-    int distance = delta(palette_entry, color.rgb);
-    if (distance < min_distance)
-    {
-      min_distance = distance;
+    if (distances[i] < distances[best_index])
       best_index = i;
-    }
   }
 
   return best_index;
@@ -218,14 +218,35 @@ int ColorMap::deflate(int rgb)
   return deflated;
 }
 
-void ColorMap::set_monochrome(int rgb)
-{
-  monochrome_color = rgb;
-}
-
 void ColorMap::initialize_color_state(ColorState& state, EDepthType depth)
 {
   const ColorFormat* pf = toFormater(depth);
   state.depth = depth;
   pf->initialize_palette(state);
 }
+
+DeflateCache::DeflateCache()
+{
+  clear();
+}
+
+void DeflateCache::clear()
+{
+  for (auto& entry : _entries)
+    entry = { -1, 0 };
+}
+
+int DeflateCache::deflate(const ColorState& state, const Color& color)
+{
+  if (color.paletted)
+    return ColorMap::deflate(state, color);
+
+  int rgb = color.rgb & 0xFFFFFF;
+  if (rgb != color.rgb)
+    return ColorMap::deflate(state, color);
+
+  Entry& entry = _entries[(static_cast<uint32_t>(rgb) * 2654435761u) >> 20];
+  if (entry.rgb != rgb)
+    entry = { rgb, ColorMap::deflate(state, color) };
+  return entry.value;
+}
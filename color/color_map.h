@@ -10,6 +10,27 @@ public:
 
   static int deflate(int rgb);
 
+  // sets the depth and its default palette, the monochrome color is kept
   static void initialize_color_state(ColorState& state, EDepthType depth);
-  static void set_monochrome(int rgb);
+};
+
+// Memoizes ColorMap::deflate for one color state
+// Entries are keyed by the full rgb, so results are exact. The owner must clear
+// the cache whenever the palette or depth of the color state changes.
+class DeflateCache
+{
+public:
+  DeflateCache();
+  int deflate(const ColorState& state, const Color& color);
+  void clear();
+
+  static const size_t size = 4096;
+
+private:
+  struct Entry
+  {
+    int rgb; // -1 when empty
+    int value;
+  };
+  Entry _entries[size];
 };
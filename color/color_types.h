@@ -30,4 +30,5 @@ struct ColorState
   };
   int palette[PALETTE_SIZE];
   EDepthType depth;
+  int monochrome = 0xffffff; // what 1 inflates to at depth 1
 };
@@ -36,12 +36,12 @@ bool Component::initialize(Client* client, Value& config)
   return onInitialize();
 }
 
-string Component::type() const
+const string& Component::type() const
 {
   return LuaProxy::name();
 }
 
-string Component::address() const
+const string& Component::address() const
 {
   return _address;
 }
@@ -58,12 +58,11 @@ string Component::make_address()
   vector<int> sets{ 4, 2, 2, 2, 6 };
   string result = "";
 
-  static bool rand_initialized = false;
-  if (!rand_initialized)
-  {
+  static bool rand_initialized = [] {
     srand(time(nullptr));
-    rand_initialized = true;
-  }
+    return true;
+  }();
+  (void)rand_initialized;
 
   for (auto len : sets)
   {
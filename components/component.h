@@ -34,9 +34,15 @@ public:
   {
     return true;
   }
+  // fast reboot keeps components alive between boots, drop what belongs to the last boot
+  // the computer closes its lua state first, its finalizers dispose the userdata it was given
+  virtual bool onReboot()
+  {
+    return true;
+  }
   virtual ~Component() = default;
-  string type() const;
-  string address() const;
+  const string& type() const;
+  const string& address() const;
   int slot() const;
 
   virtual RunState update()
@@ -9,7 +9,6 @@
 #include <chrono>
 #include <cstring>
 #include <iostream>
-#include <thread>
 using Logging::lout;
 using std::chrono::duration;
 using std::chrono::duration_cast;
@@ -17,6 +16,9 @@ using std::chrono::system_clock;
 
 const float memory_scale = 1;
 
+// smaller chunks are mostly one-off loads (e.g. the lua shell), not libraries
+static const size_t chunk_cache_min_size = 1024;
+
 bool Computer::s_registered = Host::registerComponentType<Computer>("computer");
 
 inline double now()
@@ -51,9 +53,9 @@ Computer::Computer()
   add("print", &Computer::print);
 }
 
-void Computer::stackLog(const string& stack_log)
+void Computer::stackLog(const string& stack_log, size_t sample_bytes)
 {
-  _prof.open(stack_log);
+  _prof.open(stack_log, sample_bytes);
 }
 
 Computer::~Computer()
@@ -96,42 +98,33 @@ string get_stacktrace(lua_State* lua)
 void* Computer::alloc(void* ptr, size_t osize, size_t nsize)
 {
   osize = ptr ? osize : 0; // do not use osize if ptr is null
-  if (nsize > osize)       // rise
+  if (nsize > osize && _arena.used() + (nsize - osize) > _memory_limit) // rise
   {
-    size_t to_alloc = nsize - osize;
-    size_t free_mem = freeMemory();
-    if (to_alloc > free_mem)
-    {
-      return nullptr;
-    }
+    return nullptr;
   }
 
   string stacktrace;
-  if (_prof.is_open())
+  size_t sample_weight = 0;
+  bool profiled = _prof.is_open() && (nsize != osize || !ptr);
+  // only sampled allocations pay for a stack trace
+  if (profiled && _baseline_initialized && nsize != 0)
   {
-    if (_baseline_initialized && nsize != 0)
-    {
+    sample_weight = _prof.sample(nsize);
+    if (sample_weight)
       stacktrace = get_stacktrace(_state);
-    }
-
-    if (ptr && (nsize == 0 || nsize != osize))
-    {
-      _prof.release(ptr);
-    }
   }
 
-  void* ret_ptr = nullptr;
-  if (nsize != 0)
-    ret_ptr = realloc(ptr, nsize);
+  void* ret_ptr = _arena.realloc(ptr, osize, nsize);
 
-  if (_prof.is_open() && _baseline_initialized && ret_ptr)
-    _prof.trace(stacktrace, ret_ptr, nsize);
-
-  if (nsize == 0)
+  // a failed realloc leaves lua with the old block, it stays live
+  if (profiled && ptr && (ret_ptr || nsize == 0))
   {
-    free(ptr);
-    return nullptr;
+    _prof.release(ptr);
   }
+
+  if (sample_weight && ret_ptr)
+    _prof.trace(stacktrace, ret_ptr, nsize, sample_weight);
+
   return ret_ptr;
 }
 
@@ -151,11 +144,35 @@ bool Computer::onInitialize()
     }
   }
 
+  return openState();
+}
+
+bool Computer::openState()
+{
   _state = lua_newstate(&alloc_handler, this);
+  if (!_state)
+    return false;
   luaL_openlibs(_state); // needed for common globals
   newlib(this);
+  return true;
+}
+
+bool Computer::onReboot()
+{
+  close(true);
+  _machine = nullptr;
 
-  return _state != nullptr;
+  // signals queued for the last boot are not delivered to the next one
+  _signals.drain([](const SignalPack&) {});
+  _signal.clear();
+
+  _start_time = now();
+  _standby = 0;
+  _baseline = 0;
+  _baseline_initialized = false;
+  _memory_limit = std::numeric_limits<size_t>::max();
+
+  return openState();
 }
 
 void Computer::setTmpAddress(const string& addr)
@@ -163,10 +180,13 @@ void Computer::setTmpAddress(const string& addr)
   _tmp_address = addr;
 }
 
-void Computer::pushSignal(const ValuePack& pack)
+bool Computer::pushSignal(const SignalPack& pack)
 {
   //trace(nullptr, true);
-  _signals.push(pack);
+  if (!_signals.try_push(pack))
+    return false;
+  client()->notifier()->notify();
+  return true;
 }
 
 int Computer::realTime(lua_State* lua)
@@ -303,6 +323,9 @@ void Computer::injectCustomLua()
   inject_address(_state, address());
   inject_time(_state);
   inject_date(_state);
+  // wrapped by inject_xp_load, it must see the cached load
+  if (client()->system()->chunk_cache())
+    _chunks->install(_state, chunk_cache_min_size);
   inject_xp_load(_state);
   inject_print(_state);
 }
@@ -368,8 +391,13 @@ int Computer::getProgramLocations(lua_State* lua)
 
 int Computer::pushSignal(lua_State* lua)
 {
-  pushSignal(ValuePack::pack(lua));
-  return 0;
+  SignalPack pack;
+  int top = lua_gettop(lua);
+  for (int index = 1; index <= top; index++)
+  {
+    pack.add(lua, index);
+  }
+  return ValuePack::ret(lua, pushSignal(pack));
 }
 
 bool Computer::postInit()
@@ -383,6 +411,7 @@ bool Computer::postInit()
     }
   }
 
+  _chunks.reset(new ChunkCache(client()->envPath() + "/.cache/chunks"));
   injectCustomLua();
 
   _machine = lua_newthread(_state);
@@ -402,7 +431,8 @@ bool Computer::postInit()
     client()->appendCrashText("failed to read machine file [" + machine_path + "]");
     return false;
   }
-  if (luaL_loadbuffer(_state, data.c_str(), data.size(), "machine.lua"))
+  uint64_t mtime = fs_utils::lastModified(machine_path);
+  if (_chunks->load(_state, machine_path, data, "machine.lua", "bt", mtime) != LUA_OK)
   {
     client()->appendCrashText("failed to load machine [" + machine_path + "]");
     client()->appendCrashText(lua_tostring(_state, -1));
@@ -475,15 +505,14 @@ RunState Computer::update()
   {
     // kbcode signals?
     // modem message signals?
-    if (!_signals.empty())
+    if (_signals.pop(_signal))
     {
-      nargs = _signals.front().push(_state);
-      _signals.pop();
+      nargs = _signal.push(_state);
     }
-    else if (_standby > now()) // return true without resume to return to the framer update
+    else if (_standby > now()) // return without resume to return to the framer update
     {
-      // std::this_thread::yield();
-      std::this_thread::sleep_for(std::chrono::milliseconds(50));
+      // the client idles until the standby expires or a new signal is pushed
+      client()->wakeAt(_standby);
       return RunState::Continue;
     }
   }
@@ -494,12 +523,12 @@ RunState Computer::update()
     // we seem to allocate a bit more above real oc
     _baseline = memoryUsedRaw() + 91227;
     _baseline_initialized = true;
+    if (_total_memory < std::numeric_limits<size_t>::max() - _baseline)
+      _memory_limit = _baseline + _total_memory;
     lout << "lua env baseline: " << _baseline << endl;
   }
-  if (result == RunState::Continue && nargs == 0)
-  {
-    std::this_thread::sleep_for(std::chrono::milliseconds(50));
-  }
+  // run again right away, other components (e.g. the screen) update before we idle
+  client()->wakeAt(0);
   return result;
 }
 
@@ -606,17 +635,25 @@ RunState Computer::resume(int nargs)
   return RunState::Continue;
 }
 
-void Computer::close()
+void Computer::close(bool keep_pages)
 {
   if (_state)
   {
+    if (_baseline_initialized && _arena.peak() > _baseline)
+      _peek_memory = std::max(_peek_memory, _arena.peak() - _baseline);
+
     lua_close(_state);
     _state = nullptr;
+    // lua has released everything, drop the pages wholesale
+    _arena.reset(keep_pages);
     lout << "lua env closed\n";
   }
 
   _prof.flush();
 
+  if (_chunks)
+    lout << "chunk cache: " << _chunks->hits() << " hits, " << _chunks->misses() << " misses\n";
+
   lout << "computer peek memory: " << _peek_memory << endl;
   _peek_memory = 0;
 }
@@ -643,22 +680,7 @@ bool Computer::newlib(LuaProxy* proxy)
   for (const auto& tup : proxy->methods())
   {
     const string& name = std::get<0>(tup);
-    bool isDirect = std::get<1>(tup);
-    lua_CFunction pf = std::get<2>(tup);
-
-    if (isDirect)
-    {
-      lua_pushcfunction(_state, pf);
-    }
-    else
-    {
-      lua_newtable(_state);
-      lua_pushstring(_state, name.c_str());
-      lua_setfield(_state, -2, "name");
-      lua_pushlightuserdata(_state, proxy);
-      lua_setfield(_state, -2, "instance");
-      lua_pushcclosure(_state, pf, 1);
-    }
+    proxy->pushMethod(_state, tup);
 
     if (bGlobalMethods)
     {
@@ -700,10 +722,7 @@ void Computer::mark_gc()
 
 size_t Computer::memoryUsedRaw()
 {
-  if (_state == nullptr)
-    return 0;
-
-  return lua_gc(_state, LUA_GCCOUNT, 0) * 1024 + lua_gc(_state, LUA_GCCOUNTB, 0);
+  return _arena.used();
 }
 
 size_t Computer::memoryUsedVM()
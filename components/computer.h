@@ -1,9 +1,13 @@
 #pragma once
 
 #include "component.h"
+#include "io/mpsc_queue.h"
+#include "model/chunk_cache.h"
 #include "model/prof_log.h"
-#include <queue>
-using std::queue;
+#include "model/signal_pack.h"
+#include "model/slab_arena.h"
+#include <limits>
+#include <memory>
 
 class Computer : public Component
 {
@@ -18,13 +22,16 @@ public:
 
   RunState update() override;
   bool newlib(LuaProxy* proxy);
-  void close();
+  // keep_pages leaves the arena pages for the next lua state (see onReboot)
+  void close(bool keep_pages = false);
   void setTmpAddress(const string& addr);
-  void pushSignal(const ValuePack& pack);
+  bool pushSignal(const SignalPack& pack);
   bool postInit() override;
+  // closes the lua state and opens a fresh one, postInit loads the machine again
+  bool onReboot() override;
 
   void* alloc(void* ptr, size_t osize, size_t nsize);
-  void stackLog(const string& stack_log);
+  void stackLog(const string& stack_log, size_t sample_bytes);
 
   int isRunning(lua_State* lua);
   int setArchitecture(lua_State* lua);
@@ -62,6 +69,7 @@ protected:
 
 private:
   void injectCustomLua();
+  bool openState();
 
   double _start_time;
   string _tmp_address;
@@ -73,8 +81,16 @@ private:
   size_t _total_memory = 0;
   size_t _baseline = 0;
   bool _baseline_initialized = false;
+  // baseline + total memory, the allocator refuses to grow past it
+  size_t _memory_limit = std::numeric_limits<size_t>::max();
+  SlabArena _arena;
+  // compiled machine.lua, and os libraries when the system chunkCache setting is on
+  std::unique_ptr<ChunkCache> _chunks;
 
-  queue<ValuePack> _signals;
+  // oc drops signals once 256 are pending
+  MpscQueue<SignalPack, 256> _signals;
+  // the signal being delivered, popping swaps its buffer with the queue cell
+  SignalPack _signal;
 
   size_t _gc_ticks = 0;
   ProfLog _prof;
@@ -29,7 +29,7 @@ bool DataCard::onInitialize()
 
 int DataCard::crc32(lua_State* lua)
 {
-  vector<char> value = Value::checkArg<vector<char>>(lua, 1);
+  string_view value = Value::checkArg<string_view>(lua, 1);
   uint32_t crc = util::crc32(value);
   
   vector<char> ret{
@@ -44,7 +44,7 @@ int DataCard::crc32(lua_State* lua)
 
 int DataCard::md5(lua_State* lua)
 {
-  vector<char> value = Value::checkArg<vector<char>>(lua, 1);
+  string_view value = Value::checkArg<string_view>(lua, 1);
 
   return ValuePack::ret(lua, util::md5(value));
 }
@@ -5,11 +5,21 @@
 #include "model/log.h"
 using Logging::lout;
 
-#include <fstream>
+#include <chrono>
+#include <limits>
 #include <string.h>
+using namespace std::chrono;
 
 bool Drive::s_registered = Host::registerComponentType<Drive>("drive");
 
+// how long written sectors may wait in the page cache before they are synced to the disk
+static const double flush_interval = 5;
+
+inline double now()
+{
+  return duration_cast<duration<double>>(system_clock::now().time_since_epoch()).count();
+}
+
 Drive::Drive()
 {
   add("writeByte", &Drive::writeByte, "");
@@ -25,9 +35,7 @@ Drive::Drive()
 
 Drive::~Drive()
 {
-  std::ofstream writer(_hostPath);
-  writer.write(_buffer.data(), _buffer.size());
-  writer.close();
+  flush(true);
 }
 
 int Drive::writeByte(lua_State* lua)
@@ -36,9 +44,8 @@ int Drive::writeByte(lua_State* lua)
   int byte = Value::checkArg<int>(lua, 2);
   int sector = offsetToSector(offset);
   validateSector(lua, sector);
-  std::vector<char> data;
-  data.push_back(byte);
-  write(offset, data);
+  char data = static_cast<char>(byte);
+  write(offset, std::string_view(&data, 1));
   return ValuePack::ret(lua);
 }
 
@@ -57,7 +64,7 @@ int Drive::setLabel(lua_State* lua)
 {
   string new_label = Value::checkArg<string>(lua, 1);
   int stack = getLabel(lua);
-  update(ConfigIndex::Label, new_label);
+  Component::update(ConfigIndex::Label, new_label);
   return stack;
 }
 
@@ -88,11 +95,17 @@ int Drive::getLabel(lua_State* lua)
 int Drive::writeSector(lua_State* lua)
 {
   int sector = Value::checkArg<int>(lua, 1) - 1;
-  std::vector<char> data = Value::checkArg<std::vector<char>>(lua, 2);
+  std::string_view data = Value::checkArg<std::string_view>(lua, 2);
   validateSector(lua, sector);
-  data.resize(getSectorSize());
+  size_t sector_size = getSectorSize();
+  data = data.substr(0, sector_size);
   int offset = sectorToOffset(sector);
   write(offset, data);
+  if (data.size() < sector_size)
+  {
+    // the rest of the sector is cleared
+    write(offset + data.size(), std::string(sector_size - data.size(), '\0'));
+  }
   return ValuePack::ret(lua);
 }
 
@@ -124,26 +137,70 @@ bool Drive::onInitialize()
   }
   _tier = tier.toNumber();
 
-  if (fs_utils::exists(_hostPath))
+  Value capacity = config().get(ConfigIndex::Capacity);
+  if (capacity.type() == "number")
   {
-    fs_utils::read(_hostPath, _buffer);
-    _buffer.resize(getCapacity());
+    // whole sectors, and offsets are ints
+    double bytes = std::min(capacity.toNumber(), static_cast<double>(std::numeric_limits<int>::max()));
+    _capacity = static_cast<int>(bytes) / getSectorSize() * getSectorSize();
   }
   else
   {
-    _buffer.resize(getCapacity());
-    std::ofstream file(_hostPath, std::ios_base::app | std::ios_base::out);
-    if (!file)
+    int kbs;
+    switch (_tier)
     {
-      lout << "Failed to initialize drive[" << address() << "] file" << std::endl;
-      return false;
+      case 1: kbs = 1024; break;
+      case 2: kbs = 2048; break;
+      case 3: kbs = 4096; break;
+      default: kbs = 0;
     }
-    file.close();
+    _capacity = kbs * 1024;
   }
 
+  // the image is mapped, not loaded: sectors are paged in as they are read
+  // its blocks are reserved here, a full host disk fails the drive now rather than a write later
+  if (!_image.open(_hostPath, _capacity))
+  {
+    lout << "Failed to initialize drive[" << address() << "] file" << std::endl;
+    return false;
+  }
+  _dirty.assign(_capacity / getSectorSize(), false);
+
   return true;
 }
 
+RunState Drive::update()
+{
+  if (_dirty_count > 0 && now() >= _next_flush)
+    flush(false);
+  if (_dirty_count > 0)
+    client()->wakeAt(_next_flush);
+  return RunState::Continue;
+}
+
+void Drive::flush(bool wait)
+{
+  size_t sector_size = getSectorSize();
+  size_t sector = 0;
+  while (_dirty_count > 0 && sector < _dirty.size())
+  {
+    if (!_dirty[sector])
+    {
+      sector++;
+      continue;
+    }
+
+    // sync each run of dirty sectors at once
+    size_t first = sector;
+    while (sector < _dirty.size() && _dirty[sector])
+    {
+      _dirty[sector++] = false;
+      _dirty_count--;
+    }
+    _image.sync(first * sector_size, (sector - first) * sector_size, wait);
+  }
+}
+
 int Drive::getSectorSize()
 {
   return 512;
@@ -151,15 +208,7 @@ int Drive::getSectorSize()
 
 int Drive::getCapacity()
 {
-  int kbs;
-  switch (_tier)
-  {
-    case 1: kbs = 1024; break;
-    case 2: kbs = 2048; break;
-    case 3: kbs = 4096; break;
-    default: kbs = 0;
-  }
-  return kbs * 1024;
+  return _capacity;
 }
 
 int Drive::offsetToSector(int offset)
@@ -174,8 +223,8 @@ int Drive::sectorToOffset(int sector)
 
 int Drive::validateSector(lua_State* lua, int sector)
 {
-  int offset = sectorToOffset(sector);
-  if (sector < 0 || offset >= getCapacity())
+  // compare sectors, the offset of a bad sector can overflow
+  if (sector < 0 || sector >= getCapacity() / getSectorSize())
   {
     return luaL_error(lua, "invalid offset, not in a usable sector");
   }
@@ -189,35 +238,47 @@ std::vector<char> Drive::read(int offset, int size)
   assert(size >= 0);
   if (size == 0) return {};
 
-  if (static_cast<size_t>(offset) >= _buffer.size())
+  if (static_cast<size_t>(offset) >= _image.size())
   {
     return {};
   }
 
-  size_t expectedAvail = static_cast<size_t>(offset + size);
-  if (expectedAvail > _buffer.size())
+  size_t expectedAvail = static_cast<size_t>(offset) + size;
+  if (expectedAvail > _image.size())
   {
-    size = _buffer.size() - offset;
+    size = _image.size() - offset;
   }
 
-  std::vector<char> buffer;
-  buffer.resize(size);
-  ::memcpy(buffer.data(), _buffer.data() + offset, buffer.size());
-  return buffer;
+  const char* begin = _image.data() + offset;
+  return std::vector<char>(begin, begin + size);
 }
 
-void Drive::write(int offset, std::vector<char> data)
+void Drive::write(int offset, std::string_view data)
 {
   assert(offset >= 0);
   size_t uoffset = static_cast<size_t>(offset);
-  if (uoffset >= _buffer.size())
+  if (uoffset >= _image.size())
   {
     lout << "bad drive write beyond buffer" << std::endl;
     return;
   }
 
-  size_t limit = _buffer.size() - uoffset;
+  size_t limit = _image.size() - uoffset;
   size_t write_size = std::min(limit, data.size());
+  if (write_size == 0)
+    return;
+
+  ::memcpy(_image.data() + uoffset, data.data(), write_size);
 
-  ::memcpy(_buffer.data() + uoffset, data.data(), write_size);
+  size_t sector_size = getSectorSize();
+  size_t last = (uoffset + write_size - 1) / sector_size;
+  for (size_t sector = uoffset / sector_size; sector <= last; sector++)
+  {
+    if (!_dirty[sector])
+    {
+      if (_dirty_count++ == 0)
+        _next_flush = now() + flush_interval;
+      _dirty[sector] = true;
+    }
+  }
 }
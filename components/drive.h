@@ -1,7 +1,9 @@
 #pragma once
 #include "component.h"
+#include "drivers/mapped_file.h"
 
 #include <string>
+#include <string_view>
 #include <vector>
 
 class Drive : public Component
@@ -13,7 +15,8 @@ public:
   enum ConfigIndex
   {
     Tier = Component::ConfigIndex::Next,
-    Label
+    Label,
+    Capacity // bytes, overrides the capacity of the tier
   };
 
   int writeByte(lua_State* lua);
@@ -28,6 +31,7 @@ public:
 
 protected:
   bool onInitialize() override;
+  RunState update() override;
 
   int getSectorSize();
   int getCapacity();
@@ -37,12 +41,18 @@ protected:
   int validateSector(lua_State* lua, int sector);
 
   std::vector<char> read(int offset, int size);
-  void write(int offset, std::vector<char> data);
+  void write(int offset, std::string_view data);
+  // syncs the dirty sectors back to the drive file, wait blocks until they are on the disk
+  void flush(bool wait);
 
 private:
   std::string _hostPath; // empty when invalid
   int _tier;
-  std::vector<char> _buffer;
+  int _capacity = 0;
+  MappedFile _image;
+  std::vector<bool> _dirty; // per sector, written since the last flush
+  size_t _dirty_count = 0;
+  double _next_flush = 0;
 
   static bool s_registered;
 };
@@ -60,7 +60,7 @@ int Eeprom::get(lua_State* lua)
 int Eeprom::getChecksum(lua_State* lua)
 {
   vector<char> bios = this->load(biosPath());
-  uint32_t crc = util::crc32(bios);
+  uint32_t crc = util::crc32({ bios.data(), bios.size() });
   std::stringstream ret;
   ret << std::hex << crc;
 
@@ -69,8 +69,8 @@ int Eeprom::getChecksum(lua_State* lua)
 
 int Eeprom::set(lua_State* lua)
 {
-  static const vector<char> default_value{};
-  vector<char> value = Value::checkArg<vector<char>>(lua, 1, &default_value);
+  static const string_view default_value{};
+  string_view value = Value::checkArg<string_view>(lua, 1, &default_value);
   size_t len = value.size();
   if (len > static_cast<size_t>(_bios_size_limit))
     return ValuePack::ret(lua, Value::nil, "bios size exceeded");
@@ -111,8 +111,8 @@ int Eeprom::getDataSize(lua_State* lua)
 
 int Eeprom::setData(lua_State* lua)
 {
-  static const vector<char> default_value{};
-  vector<char> value = Value::checkArg<vector<char>>(lua, 1, &default_value);
+  static const string_view default_value{};
+  string_view value = Value::checkArg<string_view>(lua, 1, &default_value);
   size_t len = value.size();
   if (_data_size_limit < 0 || len > static_cast<size_t>(_data_size_limit))
     return ValuePack::ret(lua, Value::nil, "data size exceeded");
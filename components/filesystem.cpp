@@ -2,13 +2,18 @@
 #include "apis/system.h"
 #include "apis/userdata.h"
 #include "drivers/fs_utils.h"
+#include "drivers/host_fs.h"
+#include "drivers/image_fs.h"
+#include "drivers/overlay_fs.h"
+#include "drivers/ram_fs.h"
 #include "model/client.h"
 #include "model/host.h"
 #include "model/log.h"
 #include <fstream>
 #include <limits>
+#include <map>
+#include <mutex>
 using Logging::lout;
-using std::ifstream;
 using std::numeric_limits;
 
 bool Filesystem::s_registered = Host::registerComponentType<Filesystem>("filesystem");
@@ -20,216 +25,83 @@ constexpr inline int32_t truncate_double(const double& value)
   return static_cast<int32_t>(std::min(max_size, std::max(min_size, value)));
 }
 
-constexpr inline int32_t truncate(const int32_t& value, const int32_t& min_value, const int32_t& max_value)
-{
-  return std::min(max_value, std::max(min_value, value));
-}
-
 class FileHandle : public UserData
 {
 public:
-  FileHandle(Filesystem* fs)
+  FileHandle(Filesystem* fs, unique_ptr<FsFile> file, bool reader)
       : _fs(fs)
+      , _file(std::move(file))
+      , _reader(reader)
   {
   }
 
-  const Filesystem* fs() const
-  {
-    return _fs;
-  }
-
   void dispose() override
   {
     close();
     _fs->release(this);
   }
 
-  virtual bool isOpen() const
+  bool isOpen() const
   {
-    if (_fs == nullptr)
-      return false;
-
-    return _isOpen;
+    return _file != nullptr;
   }
 
   bool canRead() const
   {
-    return isOpen() && _isReader();
+    return isOpen() && _reader;
   }
 
   bool canWrite() const
   {
-    return isOpen() && !_isReader();
+    return isOpen() && !_reader;
   }
 
   void close()
   {
-    _close();
-    _isOpen = false;
+    _file.reset();
   }
 
-  virtual vector<char> read(int32_t size)
+  FsFile* file() const
   {
-    return {};
+    return _file.get();
   }
-  virtual void write(const vector<char>& data)
-  {
-  }
-  virtual bool eof() const
-  {
-    return false;
-  }
-
-  virtual bool seek(int32_t to, std::ios_base::seekdir way) = 0;
-  virtual int32_t tell() = 0;
-
-protected:
-  virtual void _close() = 0;
-  virtual bool _isReader() const = 0;
-  bool _isOpen;
 
 private:
   Filesystem* _fs;
+  unique_ptr<FsFile> _file;
+  bool _reader;
 };
 
-class FileHandleReader : public FileHandle
+// loot trees are read only, vms using the same tree share one backend
+// the tree is a host directory or a packed image, null when the image is malformed
+static shared_ptr<FsBackend> open_loot(const string& path, uint64_t capacity)
 {
-public:
-  FileHandleReader(Filesystem* fs, const string& filepath, fstream::openmode mode)
-      : FileHandle(fs)
-      , _position(0)
-  {
-    ifstream fin(filepath, mode);
-    if (fin)
-    {
-      _isOpen = true;
-      _data = { std::istreambuf_iterator<char>(fin), std::istreambuf_iterator<char>() };
-    }
-    fin.close();
-  }
+  static std::mutex m;
+  static std::map<std::pair<string, uint64_t>, std::weak_ptr<FsBackend>> trees;
 
-  bool seek(int32_t to, std::ios_base::seekdir way) override
+  std::unique_lock<std::mutex> lk(m);
+  auto& tree = trees[{path, capacity}];
+  shared_ptr<FsBackend> backend = tree.lock();
+  if (!backend)
   {
-    switch (way)
+    if (fs_utils::isDirectory(path))
     {
-    case std::ios_base::cur:
-      _position += to;
-      break;
-    case std::ios_base::beg:
-      _position = to;
-      break;
-    case std::ios_base::end:
-    default:
-      _position = static_cast<int32_t>(_data.size()) + to;
-      break;
+      backend = std::make_shared<HostFs>(path, true, capacity);
     }
-
-    return true;
-  }
-
-  int32_t tell() override
-  {
-    return _position;
-  }
-
-  vector<char> read(int32_t size) override
-  {
-    int32_t size_trunc = static_cast<int32_t>(_data.size());
-    size = truncate(size, 0, size_trunc - _position);
-    if (size <= 0)
-      return {};
-
-    int32_t offset = truncate(_position, 0, size_trunc);
-    int32_t read_from_data = truncate(size, 0, size_trunc - offset);
-    int32_t fill_bytes = size - read_from_data;
-
-    vector<char> buffer(_data.begin() + offset, _data.begin() + offset + read_from_data);
-
-    while (fill_bytes--)
+    else
     {
-      buffer.push_back(0);
+      auto image = std::make_shared<ImageFs>(path);
+      if (!image->isOpen())
+        return nullptr;
+      backend = image;
     }
-
-    _position += buffer.size();
-    return buffer;
-  }
-
-  bool eof() const override
-  {
-    return _position >= static_cast<int32_t>(_data.size());
-  }
-
-protected:
-  void _close() override
-  {
-    _position = 0;
-    _data.clear();
-  }
-
-  bool _isReader() const override
-  {
-    return true;
+    tree = backend;
   }
-
-private:
-  int32_t _position;
-  vector<char> _data;
-};
-
-class FileHandleWriter : public FileHandle
-{
-public:
-  FileHandleWriter(Filesystem* fs, const string& filepath, fstream::openmode mode)
-      : FileHandle(fs)
-  {
-    _stream.open(filepath, mode);
-    _isOpen = _stream.is_open();
-  }
-
-  void write(const vector<char>& data) override
-  {
-    _stream.write(data.data(), data.size());
-  }
-
-  bool seek(int32_t to, std::ios_base::seekdir way) override
-  {
-    // we may have read past the eof
-    _stream.clear();
-
-    _stream.seekg(to, way);
-
-    if (_stream.fail() || _stream.bad())
-    {
-      _stream.clear();
-      return false;
-    }
-
-    return true;
-  }
-
-  int32_t tell() override
-  {
-    return static_cast<int32_t>(_stream.tellg());
-  }
-
-protected:
-  void _close() override
-  {
-    _stream.close();
-  }
-
-  bool _isReader() const override
-  {
-    return false;
-  }
-
-private:
-  fstream _stream;
-};
+  return backend;
+}
 
 Filesystem::Filesystem()
-    : _isReadOnly(true)
-    , _tmpfs(false)
+    : _tmpfs(false)
 {
   add("open", &Filesystem::open,
       "function(path:string[, mode:string='r']):userdata -- Opens a new file descriptor and returns its handle.");
@@ -271,10 +143,14 @@ Filesystem::Filesystem()
 
 bool Filesystem::onInitialize()
 {
+  uint64_t capacity = 0;
+  Value capacity_setting = config().get(ConfigIndex::Capacity);
+  if (capacity_setting.type() == "number" && capacity_setting.toNumber() > 0)
+    capacity = static_cast<uint64_t>(capacity_setting.toNumber());
+
   Value source_uri = config().get(ConfigIndex::SourceUri).Or(false);
   if (source_uri.type() == "string") // loot disk
   {
-    _isReadOnly = true;
     _src = fs_utils::make_proc_path(source_uri.toString());
     _tmpfs = false;
     if (!fs_utils::exists(_src))
@@ -282,18 +158,66 @@ bool Filesystem::onInitialize()
       lout << "loot disk not found: " << _src << endl;
       return false;
     }
+
+    bool overlay = config().get(ConfigIndex::Overlay).Or(false).toBool();
+    shared_ptr<FsBackend> tree = open_loot(path(), overlay ? 0 : capacity);
+    if (!tree)
+    {
+      lout << "loot image is not valid: " << _src << endl;
+      return false;
+    }
+
+    if (overlay)
+    {
+      // the vm's writes and whiteouts are kept in the env path, the loot tree is never touched
+      string delta = clean(client()->envPath(), true, true) + clean(address(), true, true);
+      if (!fs_utils::exists(delta))
+      {
+        fs_utils::mkdir(delta);
+      }
+      unique_ptr<FsBackend> writable(new HostFs(delta, false, capacity));
+      _backend = std::make_shared<OverlayFs>(tree, std::move(writable), delta + ".whiteouts");
+    }
+    else
+    {
+      _backend = tree;
+    }
   }
   else if (source_uri.type() == "boolean")
   {
-    _isReadOnly = false;
     _src = "";
     _tmpfs = source_uri.toBool();
-    // make local dir if it doesn't yet exist
-    if (!fs_utils::exists(path()))
+    if (_tmpfs)
     {
-      fs_utils::mkdir(path());
+      _capacity = capacity > 0 ? capacity : RamFs::default_capacity;
+      _backend.reset(new RamFs(_capacity));
+    }
+    else
+    {
+      // make local dir if it doesn't yet exist
+      if (!fs_utils::exists(path()))
+      {
+        fs_utils::mkdir(path());
+      }
+      _backend.reset(new HostFs(path(), false, capacity));
     }
   }
+  return _backend != nullptr;
+}
+
+RunState Filesystem::update()
+{
+  _backend->update();
+  return RunState::Continue;
+}
+
+bool Filesystem::onReboot()
+{
+  // handles are lua userdata, closing the lua state collected them
+  _handles.clear();
+  // tmpfs is wiped on reboot, as in oc
+  if (_tmpfs)
+    _backend.reset(new RamFs(_capacity));
   return true;
 }
 
@@ -338,18 +262,6 @@ string Filesystem::clean(string arg, bool bAbs, bool removeEnd)
   return arg;
 }
 
-string Filesystem::relative(const string& requested, const string& full)
-{
-  string clean_requested = clean(requested, true, false);
-  string clean_full = clean(full, true, false);
-  if (clean_full.find(clean_requested) != 0)
-  {
-    // error in expected relative truncation, could not find root path
-    return clean_full;
-  }
-  return clean_full.substr(clean_requested.size());
-}
-
 string Filesystem::path() const
 {
   if (_src.empty()) // use local path
@@ -365,7 +277,7 @@ string Filesystem::src() const
 
 bool Filesystem::isReadOnly() const
 {
-  return _isReadOnly;
+  return _backend->isReadOnly();
 }
 
 bool Filesystem::isTmpfs() const
@@ -427,7 +339,13 @@ int Filesystem::open(lua_State* lua)
     return ValuePack::ret(lua, Value::nil, filepath);
   }
 
-  FileHandle* pfh = create(lua, filepath, mode);
+  FsBackend::OpenMode open_mode = FsBackend::OpenMode::Read;
+  if ((mode & mode_map['a']) == mode_map['a'])
+    open_mode = FsBackend::OpenMode::Append;
+  else if (bWrite)
+    open_mode = FsBackend::OpenMode::Write;
+
+  FileHandle* pfh = create(lua, filepath, open_mode);
   if (!pfh)
   {
     return ValuePack::ret(lua, Value::nil, filepath);
@@ -445,14 +363,16 @@ int Filesystem::read(lua_State* lua)
   }
 
   int32_t size = truncate_double(Value::checkArg<double>(lua, 2));
-  vector<char> data = pfh->read(size);
+  string_view data = pfh->file()->read(size);
 
-  if (data.empty() && (size > 0 || pfh->eof()))
+  if (data.empty() && (size > 0 || pfh->file()->eof()))
   {
     return ValuePack::ret(lua, Value::nil);
   }
 
-  return ValuePack::ret(lua, data);
+  // the handle owns the data, it stays on the stack until lua has its copy
+  lua_pushlstring(lua, data.data(), data.size());
+  return 1;
 }
 
 int Filesystem::write(lua_State* lua)
@@ -463,8 +383,11 @@ int Filesystem::write(lua_State* lua)
     return ValuePack::ret(lua, Value::nil, "bad file descriptor");
   }
 
-  vector<char> data = Value::checkArg<vector<char>>(lua, 2);
-  pfh->write(data);
+  string_view data = Value::checkArg<string_view>(lua, 2);
+  if (!pfh->file()->write(data))
+  {
+    return ValuePack::ret(lua, Value::nil, "not enough space");
+  }
 
   return ValuePack::ret(lua, true);
 }
@@ -495,25 +418,18 @@ int Filesystem::setLabel(lua_State* lua)
 
   string new_label = Value::checkArg<string>(lua, 1);
   int stack = getLabel(lua);
-  update(ConfigIndex::Label, new_label);
+  Component::update(ConfigIndex::Label, new_label);
   return stack;
 }
 
 int Filesystem::list(lua_State* lua)
 {
-  string request_path = path() + clean(Value::checkArg<string>(lua, 1), true, false);
-  auto listing = fs_utils::list(request_path);
+  string request_path = clean(Value::checkArg<string>(lua, 1), true, false);
 
   Value t = Value::table();
-  for (const auto& item : listing)
+  for (const auto& item : _backend->list(request_path))
   {
-    string relative_item = clean(relative(request_path, item), false, true);
-    if (fs_utils::isDirectory(item))
-    {
-      relative_item += "/";
-    }
-
-    t.insert(relative_item);
+    t.insert(item);
   }
 
   return ValuePack::ret(lua, t);
@@ -536,7 +452,7 @@ int Filesystem::isDirectory(lua_State* lua)
   string relpath = clean(given, true, true);
   if (hack_broken_dotdot(relpath))
     return ValuePack::ret(lua, Value::nil, given);
-  return ValuePack::ret(lua, fs_utils::isDirectory(path() + relpath));
+  return ValuePack::ret(lua, _backend->isDirectory(relpath));
 }
 
 int Filesystem::exists(lua_State* lua)
@@ -545,8 +461,7 @@ int Filesystem::exists(lua_State* lua)
   string given_clean = clean(given, true, true);
   if (hack_broken_dotdot(given_clean))
     return ValuePack::ret(lua, Value::nil, given);
-  string fullpath = path() + given_clean;
-  return ValuePack::ret(lua, fs_utils::exists(fullpath));
+  return ValuePack::ret(lua, _backend->exists(given_clean));
 }
 
 int Filesystem::isReadOnly(lua_State* lua)
@@ -586,24 +501,24 @@ int Filesystem::seek(lua_State* lua)
     return 0;
   }
 
-  if (!pfh->seek(static_cast<int32_t>(to), way))
+  if (!pfh->file()->seek(static_cast<int32_t>(to), way))
   {
     return ValuePack::ret(lua, Value::nil, "invalid offset");
   }
 
-  return ValuePack::ret(lua, static_cast<double>(pfh->tell()));
+  return ValuePack::ret(lua, static_cast<double>(pfh->file()->tell()));
 }
 
 int Filesystem::size(lua_State* lua)
 {
   string filepath = Value::checkArg<string>(lua, 1);
-  return ValuePack::ret(lua, fs_utils::size(path() + clean(filepath, true, false)));
+  return ValuePack::ret(lua, _backend->size(clean(filepath, true, false)));
 }
 
 int Filesystem::lastModified(lua_State* lua)
 {
   string filepath = Value::checkArg<string>(lua, 1);
-  return ValuePack::ret(lua, fs_utils::lastModified(path() + clean(filepath, true, false)));
+  return ValuePack::ret(lua, _backend->lastModified(clean(filepath, true, false)));
 }
 
 FileHandle* Filesystem::getFileHandle(lua_State* lua) const
@@ -614,42 +529,44 @@ FileHandle* Filesystem::getFileHandle(lua_State* lua) const
 
 int Filesystem::spaceUsed(lua_State* lua)
 {
-  return ValuePack::ret(lua, fs_utils::size(path(), true));
+  return ValuePack::ret(lua, _backend->spaceUsed());
 }
 
 int Filesystem::spaceTotal(lua_State* lua)
 {
+  uint64_t total = _backend->spaceTotal();
+  if (total > 0)
+    return ValuePack::ret(lua, total);
   return ValuePack::ret(lua, numeric_limits<double>::infinity());
 }
 
 int Filesystem::remove(lua_State* lua)
 {
   string filepath = Value::checkArg<string>(lua, 1);
-  filepath = path() + clean(filepath, true, false);
+  filepath = clean(filepath, true, false);
   if (isReadOnly())
   {
     return ValuePack::ret(lua, false);
   }
-  else if (!fs_utils::exists(filepath))
+  else if (!_backend->exists(filepath))
   {
     return ValuePack::ret(lua, Value::nil, "no such file or directory");
   }
-  return ValuePack::ret(lua, fs_utils::remove(filepath));
+  return ValuePack::ret(lua, _backend->remove(filepath));
 }
 
 int Filesystem::makeDirectory(lua_State* lua)
 {
   string dirpath = Value::checkArg<string>(lua, 1);
-  dirpath = path() + clean(dirpath, true, false);
-  if (isReadOnly() || fs_utils::exists(dirpath))
+  dirpath = clean(dirpath, true, false);
+  if (isReadOnly() || _backend->exists(dirpath))
   {
     return ValuePack::ret(lua, false);
   }
-  fs_utils::mkdir(dirpath);
-  return ValuePack::ret(lua, true);
+  return ValuePack::ret(lua, _backend->makeDirectory(dirpath));
 }
 
-static bool hack_broken_rename(const string& from, const string& to)
+static bool hack_broken_rename(FsBackend* backend, const string& from, const string& to)
 {
   if (to.find(from) != 0)
     return false;
@@ -666,7 +583,7 @@ static bool hack_broken_rename(const string& from, const string& to)
 
   // broken!
   // a -> a/d should fail, but oc just deletes a
-  return fs_utils::remove(from);
+  return backend->remove(from);
 }
 
 int Filesystem::rename(lua_State* lua)
@@ -674,55 +591,37 @@ int Filesystem::rename(lua_State* lua)
   string raw_from = Value::checkArg<string>(lua, 1);
   string raw_to = Value::checkArg<string>(lua, 2);
 
-  string from = path() + clean(raw_from, true, true);
-  string to = path() + clean(raw_to, true, true);
+  string from = clean(raw_from, true, true);
+  string to = clean(raw_to, true, true);
   if (isReadOnly())
   {
     return ValuePack::ret(lua, false);
   }
-  else if (fs_utils::exists(to))
+  else if (_backend->exists(to))
   {
     return ValuePack::ret(lua, false);
   }
-  else if (!fs_utils::exists(from))
+  else if (!_backend->exists(from))
   {
     return ValuePack::ret(lua, Value::nil, raw_from);
   }
-  else if (hack_broken_rename(from, to))
+  else if (hack_broken_rename(_backend.get(), from, to))
   {
     return ValuePack::ret(lua, true);
   }
-  return ValuePack::ret(lua, fs_utils::rename(from, to));
+  return ValuePack::ret(lua, _backend->rename(from, to));
 }
 
-FileHandle* Filesystem::create(lua_State* lua, const string& filepath, fstream::openmode mode)
+FileHandle* Filesystem::create(lua_State* lua, const string& filepath, FsBackend::OpenMode mode)
 {
-  string fullpath = path() + clean(filepath, true, false);
-  FileHandle* pfh = nullptr;
-
-  if (fs_utils::isDirectory(fullpath))
-  {
-    return nullptr;
-  }
-
-  if ((mode & fstream::in) == fstream::in)
-  {
-    auto pAlloc = UserDataAllocator(lua)(sizeof(FileHandleReader));
-    pfh = new (pAlloc) FileHandleReader(this, fullpath, mode);
-  }
-  else
-  {
-    auto pAlloc = UserDataAllocator(lua)(sizeof(FileHandleWriter));
-    pfh = new (pAlloc) FileHandleWriter(this, fullpath, mode);
-  }
-
-  if (!pfh->isOpen())
+  unique_ptr<FsFile> file = _backend->open(clean(filepath, true, false), mode);
+  if (!file)
   {
-    pfh->close();    // release resources if any
-    lua_pop(lua, 1); // release userdata
     return nullptr;
   }
 
+  auto pAlloc = UserDataAllocator(lua)(sizeof(FileHandle));
+  FileHandle* pfh = new (pAlloc) FileHandle(this, std::move(file), mode == FsBackend::OpenMode::Read);
   _handles.insert(pfh);
   return pfh;
 }
@@ -1,10 +1,13 @@
 #pragma once
 #include "component.h"
+#include "drivers/fs_backend.h"
 
 #include <fstream>
+#include <memory>
 #include <set>
 using std::fstream;
 using std::set;
+using std::shared_ptr;
 
 class FileHandle;
 
@@ -16,7 +19,9 @@ public:
   enum ConfigIndex
   {
     SourceUri = Component::ConfigIndex::Next,
-    Label
+    Label,
+    Capacity, // bytes, unlimited when not set, a tmpfs defaults to 64k
+    Overlay // loot only, writes go to a per vm delta in the env path
   };
 
   string path() const;
@@ -47,17 +52,19 @@ public:
 
 protected:
   bool onInitialize() override;
+  bool onReboot() override;
+  RunState update() override;
   static string clean(string arg, bool bAbs, bool removeEnd);
-  static string relative(const string& requested, const string& full);
 
-  FileHandle* create(lua_State* lua, const string& uri, fstream::openmode mode);
+  FileHandle* create(lua_State* lua, const string& uri, FsBackend::OpenMode mode);
   FileHandle* getFileHandle(lua_State* lua) const;
 
 private:
-  bool _isReadOnly;
   set<FileHandle*> _handles;
   string _src;
   bool _tmpfs;
+  uint64_t _capacity = 0; // of the tmpfs, to wipe it on reboot
+  shared_ptr<FsBackend> _backend; // host directory for loot and hdd, memory for tmpfs, loot can be shared
 
   static bool s_registered;
 };
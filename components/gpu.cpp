@@ -31,13 +31,25 @@ Gpu::Gpu()
   add("maxDepth", &Gpu::maxDepth);
   add("getPaletteColor", &Gpu::getPaletteColor);
   add("setPaletteColor", &Gpu::setPaletteColor);
+  add("getActiveBuffer", &Gpu::getActiveBuffer);
+  add("setActiveBuffer", &Gpu::setActiveBuffer);
+  add("buffers", &Gpu::buffers);
+  add("allocateBuffer", &Gpu::allocateBuffer);
+  add("freeBuffer", &Gpu::freeBuffer);
+  add("freeAllBuffers", &Gpu::freeAllBuffers);
+  add("totalMemory", &Gpu::totalMemory);
+  add("freeMemory", &Gpu::freeMemory);
+  add("getBufferSize", &Gpu::getBufferSize);
+  add("bitblt", &Gpu::bitblt);
+
+  // buffers can be drawn to before a screen is bound
+  ColorMap::initialize_color_state(_color_state, EDepthType::_8);
+  updateCodes();
 }
 
 Gpu::~Gpu()
 {
   unbind();
-  delete[] _cells;
-  _cells = nullptr;
 }
 
 void Gpu::check(lua_State* lua) const
@@ -48,9 +60,30 @@ void Gpu::check(lua_State* lua) const
   }
 }
 
+void Gpu::checkTarget(lua_State* lua) const
+{
+  if (_target == &_buffer)
+    check(lua);
+}
+
+bool Gpu::onScreen() const
+{
+  return _screen && _target == &_buffer;
+}
+
 bool Gpu::onInitialize()
 {
-  ColorMap::set_monochrome(config().get(ConfigIndex::MonochromeColor).Or(0xffffff).toNumber());
+  _color_state.monochrome = config().get(ConfigIndex::MonochromeColor).Or(0xffffff).toNumber();
+  return true;
+}
+
+bool Gpu::onReboot()
+{
+  // the screen binding stays, buffers belong to the os that allocated them
+  _vram.clear();
+  _next_vram = 1;
+  _active = 0;
+  _target = &_buffer;
   return true;
 }
 
@@ -77,6 +110,7 @@ int Gpu::bind(lua_State* lua)
   _screen = screen;
   _screen->gpu(this);
   ColorMap::initialize_color_state(_color_state, _screen->frame()->depth());
+  updateCodes();
 
   tuple<int, int> max = _screen->frame()->size();
   setResolution(std::get<0>(max), std::get<1>(max));
@@ -92,7 +126,7 @@ int Gpu::maxDepth(lua_State* lua)
 int Gpu::getResolution(lua_State* lua)
 {
   check(lua);
-  return ValuePack::ret(lua, _width, _height);
+  return ValuePack::ret(lua, _buffer.width(), _buffer.height());
 }
 
 int Gpu::setResolution(lua_State* lua)
@@ -115,7 +149,7 @@ bool Gpu::setResolution(int width, int height)
   if (!_screen || !_screen->frame())
     return false;
 
-  if (width == _width && height == _height)
+  if (width == _buffer.width() && height == _buffer.height())
     return false;
 
   resizeBuffer(width, height);
@@ -125,10 +159,10 @@ bool Gpu::setResolution(int width, int height)
 
 int Gpu::set(lua_State* lua)
 {
-  check(lua);
+  checkTarget(lua);
   int x = Value::checkArg<int>(lua, 1);
   int y = Value::checkArg<int>(lua, 2);
-  vector<char> text = Value::checkArg<vector<char>>(lua, 3);
+  string_view text = Value::checkArg<string_view>(lua, 3);
 
   static const bool default_vertical = false;
   bool bVertical = Value::checkArg<bool>(lua, 4, &default_vertical);
@@ -139,22 +173,24 @@ int Gpu::set(lua_State* lua)
 
 int Gpu::get(lua_State* lua)
 {
-  check(lua);
+  checkTarget(lua);
   int x = Value::checkArg<int>(lua, 1);
   int y = Value::checkArg<int>(lua, 2);
-  const Cell* pc = get(x, y);
-  if (!pc)
+  if (!_target->contains(x, y))
   {
     return luaL_error(lua, "index out of bounds");
   }
+  size_t index = _target->index(x, y);
 
   // palette colors are nil unless set as palette colors
   // unless depth is 4, then palette indexes are always interpretted
 
-  auto fg_ctx = makeColorContext(pc->fg);
-  auto bg_ctx = makeColorContext(pc->bg);
+  auto fg_ctx = makeColorContext(unpackColor(_target->fg(index)));
+  auto bg_ctx = makeColorContext(unpackColor(_target->bg(index)));
 
-  return ValuePack::ret(lua, pc->value,
+  char glyph[4];
+  size_t length = UnicodeApi::toutf8(_target->codepoint(index), glyph);
+  return ValuePack::ret(lua, string(glyph, length),
   std::get<0>(fg_ctx), std::get<0>(bg_ctx),
   std::get<1>(fg_ctx), std::get<1>(bg_ctx));
 }
@@ -188,34 +224,35 @@ int Gpu::getForeground(lua_State* lua)
 
 int Gpu::fill(lua_State* lua)
 {
-  check(lua);
+  checkTarget(lua);
 
   int x = Value::checkArg<int>(lua, 1);
   int y = Value::checkArg<int>(lua, 2);
   int width = Value::checkArg<int>(lua, 3);
   int height = Value::checkArg<int>(lua, 4);
-  vector<char> text = Value::checkArg<vector<char>>(lua, 5);
+  string_view text = Value::checkArg<string_view>(lua, 5);
 
-  vector<char> value = UnicodeApi::sub(text, 1, 1);
-  if (value.size() != text.size() || value.empty())
+  // the fill value must be exactly one character
+  auto subs = UnicodeApi::subs(text.data(), text.size());
+  if (text.empty() || subs.begin().next() != text.size())
   {
     return ValuePack::ret(lua, Value::nil, "invalid fill value");
   }
 
-  Cell fill_cell{
-    UnicodeApi::toString(text),
-    deflate(_fg),
-    deflate(_bg),
-    false, // not locked
-    UnicodeApi::charWidth(value, true)
-  };
+  uint32_t codepoint = UnicodeApi::tocodepoint(text.data(), text.size());
+  uint32_t colors = deflateColors();
+  int char_width = UnicodeApi::charWidth(codepoint);
+  uint8_t flags = CellBuffer::packFlags(char_width, false);
 
   for (int row = 0; row < height; row++)
   {
+    if (char_width == 1 && fillRow(x, y + row, width, codepoint, colors))
+      continue;
+
     int x_start = x;
     for (int col = 0; col < width; col++)
     {
-      x_start += set(x_start, y + row, fill_cell, false);
+      x_start += set(x_start, y + row, codepoint, colors, flags, false);
     }
   }
 
@@ -224,7 +261,7 @@ int Gpu::fill(lua_State* lua)
 
 int Gpu::copy(lua_State* lua)
 {
-  check(lua);
+  checkTarget(lua);
   int x = Value::checkArg<int>(lua, 1);
   int y = Value::checkArg<int>(lua, 2);
   int width = Value::checkArg<int>(lua, 3);
@@ -248,13 +285,13 @@ int Gpu::copy(lua_State* lua)
   if (width <= 0 || height <= 0)
     return ValuePack::ret(lua, true);
 
-  if (tx > _width || ty > _height)
+  if (tx > _target->width() || ty > _target->height())
     return ValuePack::ret(lua, true);
 
   if ((tx + width) < 1 || (ty + height) < 1)
     return ValuePack::ret(lua, true);
 
-  if (x > _width || y > _height)
+  if (x > _target->width() || y > _target->height())
     return ValuePack::ret(lua, true);
 
   if ((x + width) < 1 || (y + height) < 1)
@@ -264,28 +301,21 @@ int Gpu::copy(lua_State* lua)
     return ValuePack::ret(lua, true); // might this unlock cells?
 
   // truncate width and height so our cells are always non-null
-  width = std::min(width, _width - x + 1);
-  height = std::min(height, _height - y + 1);
+  width = std::min(width, _target->width() - x + 1);
+  height = std::min(height, _target->height() - y + 1);
 
-  vector<Cell> buffer;
-  buffer.reserve(width * height);
-
-  for (int yoffset = 0; yoffset < height; yoffset++)
-  {
-    Cell* pLine = at(x, y + yoffset);
-    for (int xoffset = 0; xoffset < width; xoffset++)
-    {
-      buffer.push_back(*pLine++);
-    }
-  }
-  Cell* pScan = buffer.data();
+  // cells that would land outside of the buffer are dropped
+  int first = std::max(1, tx);
+  int last = std::min(_target->width(), tx + width - 1);
+  if (first > last)
+    return ValuePack::ret(lua, true);
 
-  for (int yoffset = 0; yoffset < height; yoffset++)
+  // rows are copied in the order that reads each source row before it is overwritten
+  for (int n = 0; n < height; n++)
   {
-    for (int xoffset = 0; xoffset < width; xoffset++)
-    {
-      set(tx + xoffset, ty + yoffset, *pScan++, true);
-    }
+    int yoffset = dy > 0 ? height - 1 - n : n;
+    if (ty + yoffset >= 1 && ty + yoffset <= _target->height())
+      copyRow(x + first - tx, y + yoffset, first, last, ty + yoffset);
   }
 
   return ValuePack::ret(lua, true);
@@ -335,9 +365,10 @@ int Gpu::setDepth(lua_State* lua)
   if (_color_state.depth != newDepth)
   {
     // refresh screen (reinflate and deflate all cells)
-    inflate_all();
+    ColorState previous = _color_state;
     ColorMap::initialize_color_state(_color_state, newDepth);
-    deflate_all();
+    updateCodes();
+    recolor(previous);
     invalidate();
   }
 
@@ -455,73 +486,304 @@ int Gpu::setPaletteColor(lua_State* lua)
   if (prev != rgb)
   {
     // refresh screen (reinflate and deflate all cells)
-    inflate_all();
+    ColorState previous = _color_state;
     _color_state.palette[index] = rgb;
-    deflate_all();
+    updateCodes();
+    recolor(previous);
     invalidate();
   }
 
   return ValuePack::ret(lua, prev);
 }
 
-Cell* Gpu::at(int x, int y) const
+int Gpu::getActiveBuffer(lua_State* lua)
+{
+  return ValuePack::ret(lua, _active);
+}
+
+int Gpu::setActiveBuffer(lua_State* lua)
+{
+  int index = Value::checkArg<int>(lua, 1);
+  CellBuffer* target = buffer(index);
+  if (!target)
+    return ValuePack::ret(lua, Value::nil, "invalid buffer index");
+
+  int previous = _active;
+  _active = index;
+  _target = target;
+  return ValuePack::ret(lua, previous);
+}
+
+int Gpu::buffers(lua_State* lua)
+{
+  Value list = Value::table();
+  for (const auto& pair : _vram)
+  {
+    list.insert(pair.first);
+  }
+  return ValuePack::ret(lua, list);
+}
+
+int Gpu::allocateBuffer(lua_State* lua)
 {
-  // positions are 1-based
-  if (x < 1 || x > _width || y < 1 || y > _height || _cells == nullptr)
+  int max_width = 160;
+  int max_height = 50;
+  if (_screen)
+    std::tie(max_width, max_height) = _screen->frame()->size();
+
+  int width = Value::checkArg<int>(lua, 1, &max_width);
+  int height = Value::checkArg<int>(lua, 2, &max_height);
+  if (width <= 0 || height <= 0)
+    return luaL_error(lua, "invalid page dimensions: must be greater than zero");
+
+  size_t size = static_cast<size_t>(width) * height;
+  if (usedMemory() + size > vram_capacity)
+    return ValuePack::ret(lua, Value::nil, "not enough video memory");
+
+  int index = _next_vram++;
+  CellBuffer& page = _vram[index];
+  page.resize(width, height);
+  uint32_t colors = deflate(Colors::White) | (static_cast<uint32_t>(deflate(Colors::Black)) << 16);
+  page.fill(0, page.size(), ' ', colors, CellBuffer::packFlags(1, false));
+
+  return ValuePack::ret(lua, index);
+}
+
+int Gpu::freeBuffer(lua_State* lua)
+{
+  int index = Value::checkArg<int>(lua, 1, &_active);
+  auto it = _vram.find(index);
+  if (it == _vram.end())
+    return ValuePack::ret(lua, false);
+
+  if (_active == index)
+  {
+    _active = 0;
+    _target = &_buffer;
+  }
+  _vram.erase(it);
+  return ValuePack::ret(lua, true);
+}
+
+int Gpu::freeAllBuffers(lua_State* lua)
+{
+  int count = static_cast<int>(_vram.size());
+  _vram.clear();
+  _active = 0;
+  _target = &_buffer;
+  return ValuePack::ret(lua, count);
+}
+
+int Gpu::totalMemory(lua_State* lua)
+{
+  return ValuePack::ret(lua, static_cast<int>(vram_capacity));
+}
+
+int Gpu::freeMemory(lua_State* lua)
+{
+  return ValuePack::ret(lua, static_cast<int>(vram_capacity - usedMemory()));
+}
+
+int Gpu::getBufferSize(lua_State* lua)
+{
+  int index = Value::checkArg<int>(lua, 1, &_active);
+  CellBuffer* page = buffer(index);
+  if (!page)
+    return ValuePack::ret(lua, Value::nil, "invalid buffer index");
+  return ValuePack::ret(lua, page->width(), page->height());
+}
+
+int Gpu::bitblt(lua_State* lua)
+{
+  static const int screen_index = 0;
+  static const int one = 1;
+  int dst_index = Value::checkArg<int>(lua, 1, &screen_index);
+  int src_index = Value::checkArg<int>(lua, 6, &_active);
+
+  CellBuffer* dst = buffer(dst_index);
+  CellBuffer* src = buffer(src_index);
+  if (!dst || !src)
+    return luaL_error(lua, "invalid buffer index");
+  if (dst == &_buffer || src == &_buffer)
+    check(lua);
+
+  int src_width = src->width();
+  int src_height = src->height();
+  int col = Value::checkArg<int>(lua, 2, &one);
+  int row = Value::checkArg<int>(lua, 3, &one);
+  int width = Value::checkArg<int>(lua, 4, &src_width);
+  int height = Value::checkArg<int>(lua, 5, &src_height);
+  int from_col = Value::checkArg<int>(lua, 7, &one);
+  int from_row = Value::checkArg<int>(lua, 8, &one);
+
+  blit(*dst, col, row, width, height, *src, from_col, from_row);
+  return ValuePack::ret(lua, true);
+}
+
+CellBuffer* Gpu::buffer(int index)
+{
+  if (index == 0)
+    return &_buffer;
+
+  auto it = _vram.find(index);
+  if (it == _vram.end())
     return nullptr;
+  return &it->second;
+}
+
+size_t Gpu::usedMemory() const
+{
+  size_t used = 0;
+  for (const auto& pair : _vram)
+    used += pair.second.size();
+  return used;
+}
+
+// copies cells as they are between buffers, one row at a time
+void Gpu::blit(CellBuffer& dst, int col, int row, int width, int height, const CellBuffer& src, int fromCol, int fromRow)
+{
+  // clip to both buffers, positions are 1-based
+  int skip = std::max({ 0, 1 - col, 1 - fromCol });
+  col += skip;
+  fromCol += skip;
+  width -= skip;
+  skip = std::max({ 0, 1 - row, 1 - fromRow });
+  row += skip;
+  fromRow += skip;
+  height -= skip;
+  width = std::min({ width, dst.width() - col + 1, src.width() - fromCol + 1 });
+  height = std::min({ height, dst.height() - row + 1, src.height() - fromRow + 1 });
+  if (width <= 0 || height <= 0)
+    return;
+
+  bool same = &dst == &src;
+  for (int n = 0; n < height; n++)
+  {
+    // within one buffer, read each source row before it is overwritten
+    int offset = (same && row > fromRow) ? height - 1 - n : n;
+    size_t to = dst.index(col, row + offset);
+    size_t from = src.index(fromCol, fromRow + offset);
+    if (same)
+      dst.move(to, from, width);
+    else
+      dst.copy(to, src, from, width);
+  }
+
+  int last = col + width - 1;
+  for (int y = row; y < row + height; y++)
+    mendEdges(dst, col, last, y);
+
+  if (&dst == &_buffer && _screen)
+  {
+    // mending may have changed a cell on either side of the region
+    int left = std::max(1, col - 1);
+    int right = std::min(dst.width(), last + 2);
+    for (int y = row; y < row + height; y++)
+    {
+      for (int x = left; x <= right; x++)
+      {
+        _screen->frame()->write(x, y, cell(_buffer.index(x, y)), _color_state);
+      }
+    }
+  }
+}
 
-  return &_cells[(y - 1) * _width + (x - 1)];
+// the lock bits were copied as they were, leaves the row's edges the way set() would
+void Gpu::mendEdges(CellBuffer& dst, int col, int last, int y)
+{
+  size_t first = dst.index(col, y);
+  bool wide_before = col > 1 && dst.cellWidth(first - 1) > 1;
+  if (wide_before && !dst.locked(first))
+  {
+    // the glyph before the region lost its right half
+    dst.set(first - 1, ' ', dst.colors(first - 1), CellBuffer::packFlags(1, false));
+  }
+  else if (!wide_before && dst.locked(first))
+  {
+    // a right half copied without its glyph
+    dst.unlock(first);
+  }
+
+  size_t end = dst.index(last, y);
+  if (dst.cellWidth(end) > 1)
+  {
+    if (last == dst.width())
+    {
+      // no room for the right half
+      dst.set(end, ' ', dst.colors(end), CellBuffer::packFlags(1, false));
+    }
+    else
+    {
+      // the right half lies past the region, and replaces the cell there
+      if (dst.cellWidth(end + 1) > 1 && last + 2 <= dst.width())
+        dst.unlock(end + 2);
+      dst.set(end + 1, ' ', dst.colors(end), CellBuffer::packFlags(1, true));
+    }
+  }
+  else if (last < dst.width() && dst.locked(end + 1))
+  {
+    // the glyph the cell after the region belonged to was overwritten
+    dst.unlock(end + 1);
+  }
+}
+
+Cell Gpu::cell(size_t index) const
+{
+  return {
+    _buffer.codepoint(index),
+    unpackColor(_buffer.fg(index)),
+    unpackColor(_buffer.bg(index)),
+    _buffer.locked(index),
+    _buffer.cellWidth(index)
+  };
 }
 
-const Cell* Gpu::get(int x, int y) const
+Color Gpu::unpackColor(uint16_t packed) const
 {
-  return const_cast<const Cell*>(at(x, y));
+  int value = packed & 0xFF;
+  return { value, (packed & CellBuffer::PalettedBit) != 0, _codes[value] };
 }
 
-int Gpu::set(int x, int y, const Cell& cell, bool bForce)
+int Gpu::set(int x, int y, uint32_t codepoint, uint32_t colors, uint8_t flags, bool bForce)
 {
-  Cell* pCell = at(x, y);
-  int char_width = cell.width;
+  int char_width = flags & CellBuffer::WidthMask;
+  if (!_target->contains(x, y))
+    return char_width;
 
-  if (pCell && (bForce || !pCell->locked))
+  size_t index = _target->index(x, y);
+  if (bForce || !_target->locked(index))
   {
-    int distance_to_edge = _width - x + 1; // 1-based, _width is inclusive
+    int distance_to_edge = _target->width() - x + 1; // 1-based, width is inclusive
     if (char_width <= distance_to_edge || bForce)
     {
       if (char_width > 1)
       {
-        set(x + 1, y, { " ", cell.fg, cell.bg, true, 1 }, bForce);
+        set(x + 1, y, ' ', colors, CellBuffer::packFlags(1, true), bForce);
       }
-      else if (pCell->width > 1)
+      else if (_target->cellWidth(index) > 1 && _target->contains(x + 1, y))
       {
         // unlock next
-        Cell* pNext = at(x + 1, y);
-        if (pNext)
-          pNext->locked = false;
+        _target->unlock(index + 1);
       }
-      if (_screen)
-        _screen->frame()->write(x, y, cell, _color_state);
-      *pCell = cell;
+      _target->set(index, codepoint, colors, flags);
+      if (onScreen())
+        _screen->frame()->write(x, y, cell(index), _color_state);
     }
   }
 
   return char_width;
 }
 
-void Gpu::set(int x, int y, const vector<char>& text, bool bVertical)
+void Gpu::set(int x, int y, string_view text, bool bVertical)
 {
-  Color deflated_fg = deflate(_fg);
-  Color deflated_bg = deflate(_bg);
+  uint32_t colors = deflateColors();
 
-  for (const auto& sub : UnicodeApi::subs(text))
+  auto subs = UnicodeApi::subs(text.data(), text.size());
+  for (auto it = subs.begin(); it != subs.end(); ++it)
   {
-    int width = set(x, y,
-    { UnicodeApi::toString(sub),
-    deflated_fg,
-    deflated_bg,
-    false,
-    UnicodeApi::charWidth(sub, true) },
-    false);
+    uint32_t codepoint = UnicodeApi::tocodepoint(text.data() + it.start, it.next() - it.start);
+    uint8_t flags = CellBuffer::packFlags(UnicodeApi::charWidth(codepoint), false);
+    int width = set(x, y, codepoint, colors, flags, false);
     if (!bVertical)
       x += width;
     else
@@ -529,61 +791,90 @@ void Gpu::set(int x, int y, const vector<char>& text, bool bVertical)
   }
 }
 
-vector<const Cell*> Gpu::scan(int x, int y, int width) const
+// fills one row with a narrow glyph, leaving the buffer as calling set on each cell would
+// returns false when the span has locked cells that set would skip, the caller then uses set
+bool Gpu::fillRow(int x, int y, int width, uint32_t codepoint, uint32_t colors)
 {
-  vector<const Cell*> result;
-  for (int i = 0; i < width; i++)
+  if (y < 1 || y > _target->height())
+    return true;
+
+  int first = std::max(1, x);
+  int last = static_cast<int>(std::min<long long>(_target->width(), static_cast<long long>(x) + width - 1));
+  if (first > last)
+    return true;
+
+  size_t begin = _target->index(first, y);
+  size_t end = _target->index(last, y) + 1;
+
+  // the right half of a wide glyph left of the span stays
+  if (_target->locked(begin))
+  {
+    begin++;
+    first++;
+  }
+
+  // other locked cells are unlocked by overwriting the wide glyph before them
+  for (size_t i = begin; i < end; i++)
   {
-    const Cell* pCell = get(x + i, y);
-    result.push_back(pCell);
+    if (_target->locked(i) && (i == begin || _target->cellWidth(i - 1) < 2))
+      return false;
   }
 
-  return result;
+  if (begin == end)
+    return true;
+
+  if (_target->cellWidth(end - 1) > 1 && last < _target->width())
+    _target->unlock(end);
+
+  _target->fill(begin, end - begin, codepoint, colors, CellBuffer::packFlags(1, false));
+
+  if (onScreen())
+  {
+    for (int col = first; col <= last; col++)
+      _screen->frame()->write(col, y, cell(begin + (col - first)), _color_state);
+  }
+
+  return true;
 }
 
-void Gpu::resizeBuffer(int width, int height)
+// copies source cells from (sx, sy) to the span first..last of row ty
+// the span moves in one memmove, only its last two cells go through set, as they are the
+// only ones whose lock side effects on the cells right of the span are not overwritten
+void Gpu::copyRow(int sx, int sy, int first, int last, int ty)
 {
-  Cell* ptr = nullptr;
-  if (width > 0 && height > 0)
+  size_t src = _target->index(sx, sy);
+  size_t dst = _target->index(first, ty);
+  size_t count = last - first + 1;
+
+  // the source may overlap the destination, read the tail before moving
+  size_t tail = src + count - 1;
+  uint32_t tail_codepoint = _target->codepoint(tail);
+  uint32_t tail_colors = _target->colors(tail);
+  uint8_t tail_flags = _target->flags(tail);
+
+  if (count > 1)
   {
-    size_t size = width * height;
-    ptr = new Cell[size];
-    Cell* it = ptr;
-    for (int y = 0; y < height; y++)
+    size_t before = tail - 1;
+    uint32_t before_codepoint = _target->codepoint(before);
+    uint32_t before_colors = _target->colors(before);
+    uint8_t before_flags = _target->flags(before);
+
+    _target->move(dst, src, count - 1);
+    if (onScreen())
     {
-      for (int x = 0; x < width; x++)
-      {
-        const auto& prev_cell = get(x + 1, y + 1); // positions are 1-based
-        if (prev_cell)
-        {
-          *it = *prev_cell;
-        }
-        else
-        {
-          it->value = " ";
-          it->fg = {};
-          it->bg = {};
-          it->locked = false;
-          it->width = 1;
-        }
-        it++;
-      }
+      for (int col = first; col < last - 1; col++)
+        _screen->frame()->write(col, ty, cell(dst + (col - first)), _color_state);
     }
-  }
-  else
-  {
-    _width = 0;
-    _height = 0;
-  }
 
-  if (_cells)
-  {
-    delete[] _cells;
+    set(last - 1, ty, before_codepoint, before_colors, before_flags, true);
   }
 
-  _width = width;
-  _height = height;
-  _cells = ptr;
+  set(last, ty, tail_codepoint, tail_colors, tail_flags, true);
+}
+
+void Gpu::resizeBuffer(int width, int height)
+{
+  _buffer.resize(width, height);
 }
 
 void Gpu::invalidate()
@@ -593,11 +884,11 @@ void Gpu::invalidate()
 
   _screen->frame()->clear();
 
-  for (int y = 1; y <= _height; y++)
+  for (int y = 1; y <= _buffer.height(); y++)
   {
-    for (int x = 1; x <= _width; x++)
+    for (int x = 1; x <= _buffer.width(); x++)
     {
-      _screen->frame()->write(x, y, *get(x, y), _color_state);
+      _screen->frame()->write(x, y, cell(_buffer.index(x, y)), _color_state);
     }
   }
 }
@@ -611,12 +902,14 @@ void Gpu::unbind()
   _screen = nullptr;
 }
 
-Color Gpu::deflate(const Color& color)
+uint16_t Gpu::deflate(const Color& color)
 {
-  Color deflated = color;
-  deflated.rgb = ColorMap::deflate(_color_state, color);
-  deflated.code = encode(deflated.rgb);
-  return deflated;
+  return CellBuffer::packColor({ _deflate_cache.deflate(_color_state, color), color.paletted });
+}
+
+uint32_t Gpu::deflateColors()
+{
+  return deflate(_fg) | (static_cast<uint32_t>(deflate(_bg)) << 16);
 }
 
 unsigned char Gpu::encode(int rgb)
@@ -630,26 +923,32 @@ unsigned char Gpu::encode(int rgb)
   return static_cast<unsigned char>(ColorMap::deflate(rgb) & 0xFF);
 }
 
-void Gpu::inflate_all()
+void Gpu::updateCodes()
 {
-  size_t size = _width * _height;
-  for (size_t i = 0; i < size; i++)
-  {
-    auto& cell = _cells[i];
-    cell.fg.rgb = ColorMap::inflate(_color_state, cell.fg.rgb);
-    cell.bg.rgb = ColorMap::inflate(_color_state, cell.bg.rgb);
-  }
+  _deflate_cache.clear();
+  for (int value = 0; value < 256; value++)
+    _codes[value] = encode(value);
 }
 
-void Gpu::deflate_all()
+void Gpu::recolor(const ColorState& previous)
 {
-  size_t size = _width * _height;
-  for (size_t i = 0; i < size; i++)
-  {
-    auto& cell = _cells[i];
-    cell.fg = deflate(cell.fg);
-    cell.bg = deflate(cell.bg);
-  }
+  // the buffers hold at most 512 distinct packed colors, map each once
+  uint16_t map[512];
+  bool mapped[512] = {};
+  auto remap = [&](uint16_t packed) {
+    if (!mapped[packed])
+    {
+      bool paletted = (packed & CellBuffer::PalettedBit) != 0;
+      int rgb = ColorMap::inflate(previous, packed & 0xFF);
+      map[packed] = deflate({ rgb, paletted });
+      mapped[packed] = true;
+    }
+    return map[packed];
+  };
+
+  _buffer.recolor(remap);
+  for (auto& pair : _vram)
+    pair.second.recolor(remap);
 }
 
 Value Gpu::getDeviceInfo() const
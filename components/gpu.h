@@ -1,8 +1,11 @@
 #pragma once
+#include "color/color_map.h"
 #include "color/color_types.h"
 #include "component.h"
+#include "io/cell_buffer.h"
 #include "io/frame.h"
 #include "model/value.h"
+#include <map>
 #include <tuple>
 #include <vector>
 using std::tuple;
@@ -43,21 +46,43 @@ public:
   int getPaletteColor(lua_State* lua);
   int setPaletteColor(lua_State* lua);
 
+  // video ram buffers, index 0 is the screen
+  int getActiveBuffer(lua_State* lua);
+  int setActiveBuffer(lua_State* lua);
+  int buffers(lua_State* lua);
+  int allocateBuffer(lua_State* lua);
+  int freeBuffer(lua_State* lua);
+  int freeAllBuffers(lua_State* lua);
+  int totalMemory(lua_State* lua);
+  int freeMemory(lua_State* lua);
+  int getBufferSize(lua_State* lua);
+  int bitblt(lua_State* lua);
+
   // Screen callbacks
   bool setResolution(int width, int height);
   void unbind();
   void invalidate();
 
 protected:
-  vector<const Cell*> scan(int x, int y, int width) const;
-  const Cell* get(int x, int y) const;
-  int set(int x, int y, const Cell& cell, bool bForce);
-  void set(int x, int y, const vector<char>& text, bool bVertical);
+  int set(int x, int y, uint32_t codepoint, uint32_t colors, uint8_t flags, bool bForce);
+  void set(int x, int y, string_view text, bool bVertical);
+  bool fillRow(int x, int y, int width, uint32_t codepoint, uint32_t colors);
+  void copyRow(int sx, int sy, int first, int last, int ty);
 
-  Cell* at(int x, int y) const;
+  // unpacks a buffer cell for the frame
+  Cell cell(size_t index) const;
+  Color unpackColor(uint16_t packed) const;
 
   bool onInitialize() override;
-  void check(lua_State* lua) const; // throws if no screen
+  bool onReboot() override;
+  void check(lua_State* lua) const;       // throws if no screen
+  void checkTarget(lua_State* lua) const; // throws if the active buffer is the screen and there is no screen
+  bool onScreen() const;                  // true if drawing to the active buffer writes to the screen
+
+  CellBuffer* buffer(int index); // nullptr if there is no such buffer
+  size_t usedMemory() const;
+  void blit(CellBuffer& dst, int col, int row, int width, int height, const CellBuffer& src, int fromCol, int fromRow);
+  static void mendEdges(CellBuffer& dst, int col, int last, int y); // wide glyphs cut by the columns of a blit
 
   int setColorContext(lua_State* lua, bool bBack);    // returns color, index (or nil)
   int getColorAssignment(lua_State* lua, bool bBack); // returns color, boolean
@@ -68,21 +93,27 @@ protected:
   Value getDeviceInfo() const override;
 
   // color mapping to oc 256 codes
-  Color deflate(const Color& color);
-  void inflate_all();
-  void deflate_all();
+  uint16_t deflate(const Color& color);
+  uint32_t deflateColors(); // the current fg and bg, packed
+  void recolor(const ColorState& previous);
+  void updateCodes(); // call after every color state change
   unsigned char encode(int rgb);
 
 private:
   Screen* _screen = nullptr;
 
-  int _width = 0;
-  int _height = 0;
-
-  Cell* _cells = nullptr;
+  CellBuffer _buffer; // the screen
+  std::map<int, CellBuffer> _vram;
+  int _next_vram = 1;
+  int _active = 0;
+  CellBuffer* _target = &_buffer; // the active buffer, set/get/fill/copy draw here
+  unsigned char _codes[256] = {}; // encode() of every deflated value for the current color state
+  DeflateCache _deflate_cache;
   Color _bg = Colors::Black;
   Color _fg = Colors::White;
   ColorState _color_state;
 
+  static const size_t vram_capacity = 3 * 160 * 50; // a tier 3 gpu
+
   static bool s_registered;
 };
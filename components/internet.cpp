@@ -5,9 +5,19 @@
 
 #include "drivers/internet_drv.h"
 
+#include <chrono>
 #include <sstream>
+using namespace std::chrono;
 using std::stringstream;
 
+// how often connections that are waiting on the network are checked
+static const double poll_interval = 0.05;
+
+inline double now()
+{
+  return duration_cast<duration<double>>(system_clock::now().time_since_epoch()).count();
+}
+
 bool Internet::s_registered = Host::registerComponentType<Internet>("internet");
 
 Internet::Internet()
@@ -31,6 +41,14 @@ bool Internet::onInitialize()
   return true;
 }
 
+bool Internet::onReboot()
+{
+  // connections are lua userdata, closing the lua state collected them
+  while (!_connections.empty())
+    release(*_connections.begin());
+  return true;
+}
+
 int Internet::isTcpEnabled(lua_State* lua)
 {
   return ValuePack::ret(lua, _tcp);
@@ -50,7 +68,7 @@ int Internet::connect(lua_State* lua)
   {
     return ValuePack::ret(lua, Value::nil, "tcp connections are unavailable");
   }
-  if (static_cast<int>(_connections.size()) >= SystemApi::max_connections())
+  if (static_cast<int>(_connections.size()) >= client()->system()->max_connections())
   {
     return luaL_error(lua, "too many open connections");
   }
@@ -90,7 +108,7 @@ int Internet::request(lua_State* lua)
   {
     return ValuePack::ret(lua, Value::nil, "invalid address");
   }
-  if (static_cast<int>(_connections.size()) >= SystemApi::max_connections())
+  if (static_cast<int>(_connections.size()) >= client()->system()->max_connections())
   {
     return luaL_error(lua, "too many open connections");
   }
@@ -132,14 +150,18 @@ bool Internet::release(InternetConnection* pConn)
 
 RunState Internet::update()
 {
+  bool waiting = false;
   for (InternetConnection* inc : _connections)
   {
     if (inc->update())
     {
-      ValuePack pack{ "internet_ready", address() };
-      client()->pushSignal(pack);
+      client()->pushSignal({ "internet_ready", address() });
     }
+    waiting = waiting || inc->waiting();
   }
 
+  if (waiting)
+    client()->wakeAt(now() + poll_interval);
+
   return RunState::Continue;
 }
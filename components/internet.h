@@ -31,6 +31,7 @@ public:
 
 protected:
   bool onInitialize() override;
+  bool onReboot() override;
   RunState update() override;
 
   bool parsePort(string* pAddr, int* pPort) const;
@@ -28,6 +28,7 @@ void Keyboard::detach()
 bool Keyboard::onInitialize()
 {
   _preferredScreen = config().get(ConfigIndex::ScreenAddress).Or("").toString();
+  EventSource<KeyEvent>::notifier(client()->notifier());
   return true;
 }
 
@@ -33,6 +33,7 @@ bool Modem::onInitialize()
 {
   int system_port = config().get(ConfigIndex::SystemPort).Or(56000).toNumber();
   string hostAddress = config().get(ConfigIndex::HostAddress).Or("127.0.0.1").toString();
+  EventSource<ModemEvent>::notifier(client()->notifier());
   _modem.reset(new ModemDriver(this, system_port, hostAddress));
   if (!_modem->start())
   {
@@ -46,6 +47,13 @@ bool Modem::onInitialize()
   return true;
 }
 
+bool Modem::onReboot()
+{
+  // a fresh os opens its own ports, the driver and its host connection stay up
+  _ports.clear();
+  return true;
+}
+
 template <typename T>
 void write(const T& num, vector<char>* pOut)
 {
@@ -65,10 +73,10 @@ void write(const string& text, vector<char>* pOut)
 void write(const char* data, int len, vector<char>* pOut)
 {
   write<int32_t>(len, pOut);
-  std::copy(data, data + len, std::back_inserter(*pOut));
+  pOut->insert(pOut->end(), data, data + len);
 }
 
-int Modem::tryPack(lua_State* lua, const vector<char>* pAddr, int port, vector<char>* pOut) const
+int Modem::tryPack(lua_State* lua, const string_view* pAddr, int port, vector<char>* pOut) const
 {
   if (port < 1 || port > 0xffff)
     return luaL_error(lua, "invalid port number");
@@ -202,7 +210,7 @@ int Modem::broadcast(lua_State* lua)
 
 int Modem::send(lua_State* lua)
 {
-  vector<char> address = Value::checkArg<vector<char>>(lua, 1);
+  string_view address = Value::checkArg<string_view>(lua, 1);
   int port = Value::checkArg<int>(lua, 2);
   vector<char> payload;
   int ret = tryPack(lua, &address, port, &payload);
@@ -260,6 +268,22 @@ bool read_vector(const char** pInput, const char* const end, vector<char>* pOut)
   return true;
 }
 
+// the view points into the input buffer
+bool read_view(const char** pInput, const char* const end, string_view* pOut)
+{
+  int size;
+  if (!read_next<int32_t>(pInput, end, &size))
+    return false;
+
+  if (size < 0 || *pInput + size > end)
+    return false;
+
+  *pOut = string_view(*pInput, size);
+  *pInput += size;
+
+  return true;
+}
+
 RunState Modem::update()
 {
   ModemEvent me;
@@ -303,7 +327,7 @@ RunState Modem::update()
     }
 
     int distance = 0; // always zero in simulation
-    ValuePack pack{ "modem_message", address(), send_address, port, distance };
+    SignalPack pack{ "modem_message", address(), send_address, port, distance };
 
     int num_args;
     if (!read_next<int32_t>(&input, end, &num_args))
@@ -320,20 +344,19 @@ RunState Modem::update()
         continue;
       }
       // switch variables
-      vector<char> string_arg;
+      string_view string_arg;
       bool bool_arg;
       LUA_NUMBER number_arg;
-      Value v;
 
       switch (type_id)
       {
       case LUA_TSTRING:
-        if (!read_vector(&input, end, &string_arg))
+        if (!read_view(&input, end, &string_arg))
         {
           lout << "Malformed modem packet. Could not read argument [" << pack.size() << "]\n";
           continue;
         }
-        v = string_arg;
+        pack.text(string_arg);
         break;
       case LUA_TBOOLEAN:
         if (!read_next<bool>(&input, end, &bool_arg))
@@ -341,7 +364,7 @@ RunState Modem::update()
           lout << "Malformed modem packet. Could not read argument [" << pack.size() << "]\n";
           continue;
         }
-        v = bool_arg;
+        pack.boolean(bool_arg);
         break;
       case LUA_TNUMBER:
         if (!read_next<LUA_NUMBER>(&input, end, &number_arg))
@@ -349,13 +372,12 @@ RunState Modem::update()
           lout << "Malformed modem packet. Could not read argument [" << pack.size() << "]\n";
           continue;
         }
-        v = number_arg;
+        pack.number(number_arg);
         break;
-      case LUA_TNIL:
-        v = Value::nil;
+      default:
+        pack.nil();
         break;
       }
-      pack.push_back(v);
     }
 
     client()->pushSignal(pack);
@@ -38,8 +38,9 @@ public:
 
 protected:
   bool onInitialize() override;
+  bool onReboot() override;
   RunState update() override;
-  int tryPack(lua_State* lua, const vector<char>* pAddr, int port, vector<char>* pOut) const;
+  int tryPack(lua_State* lua, const string_view* pAddr, int port, vector<char>* pOut) const;
   bool isApplicable(int port, vector<char>* target);
 
   unique_ptr<ModemDriver> _modem;
@@ -1,4 +1,5 @@
 #include <algorithm>
+#include <chrono>
 #include <iostream>
 #include <vector>
 
@@ -12,8 +13,21 @@
 
 #include "apis/unicode.h"
 
+using Logging::lout;
+using std::chrono::duration;
+using std::chrono::duration_cast;
+using std::chrono::system_clock;
+
 bool Screen::s_registered = Host::registerComponentType<Screen>("screen");
 
+// enough for smooth scrolling, and it keeps a program redrawing in a loop from flooding a remote tty
+static const double default_max_fps = 60;
+
+inline double now()
+{
+  return duration_cast<duration<double>>(system_clock::now().time_since_epoch()).count();
+}
+
 Screen::Screen()
 {
   add("isOn", &Screen::isOn);
@@ -90,6 +104,9 @@ Screen::~Screen()
 
   if (_frame)
   {
+    const FrameStats& stats = _frame->stats();
+    lout << "screen frames: " << stats.presented << " presented, "
+         << stats.merged << " merged, " << stats.dropped << " dropped\n";
     _frame->close();
   }
   if (_gpu)
@@ -102,6 +119,8 @@ Screen::~Screen()
 
 bool Screen::onInitialize()
 {
+  EventSource<MouseEvent>::notifier(client()->notifier());
+
   // we now have a client and we are ready to create the frame for this screen
   _frame.reset(client()->host()->createFrame());
   if (!_frame)
@@ -109,6 +128,7 @@ bool Screen::onInitialize()
     return false;
   }
   _frame->open(this);
+  _frame->maxFps(config().get(ConfigIndex::MaxFps).Or(default_max_fps).toNumber());
 
   return true;
 }
@@ -165,6 +185,11 @@ RunState Screen::update()
     return RunState::Halt;
   }
 
+  // writes held back by the fps cap are presented by a later update
+  double delay = _frame->presentDelay();
+  if (delay >= 0)
+    client()->wakeAt(now() + delay);
+
   return RunState::Continue;
 }
 
@@ -219,3 +244,14 @@ void Screen::invalidate()
   if (_gpu)
     _gpu->invalidate();
 }
+
+void Screen::damaged()
+{
+  // the frame draws during our update, run it as soon as the frame can present
+  client()->wakeAt(now() + std::max(0.0, _frame->presentDelay()));
+}
+
+void Screen::wake()
+{
+  client()->notifier()->notify();
+}
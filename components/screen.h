@@ -10,6 +10,11 @@ class Gpu;
 class Screen : public Component, public IScreen, private EventSource<MouseEvent>
 {
 public:
+  enum ConfigIndex
+  {
+    MaxFps = Component::ConfigIndex::Next
+  };
+
   Screen();
   ~Screen();
   RunState update() override;
@@ -33,6 +38,8 @@ public:
   void push(const MouseEvent& ke) override;
   bool setResolution(int width, int height) override;
   void invalidate() override;
+  void damaged() override;
+  void wake() override;
 
   void gpu(Gpu* gpu);
   Gpu* gpu() const;
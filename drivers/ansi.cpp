@@ -1,12 +1,7 @@
 #include "ansi.h"
 #include "color/color_types.h"
 #include <algorithm>
-#include <map>
-#include <sstream>
-#include <vector>
-using std::stringstream;
-
-#include <iostream>
+#include <cstring>
 
 // clang-format off
 static const unsigned char oc_to_ansi[256] =
@@ -32,42 +27,141 @@ static const unsigned char oc_to_ansi[256] =
 };
 // clang-format on
 
-string to_ansi_deflated(unsigned char deflated_rgb, bool foreground)
+// writes value in decimal to buffer (which must hold 10 bytes), returns the digit count
+static inline size_t format_uint(char* buffer, unsigned value)
+{
+  char digits[10];
+  size_t count = 0;
+  do
+  {
+    digits[count++] = '0' + value % 10;
+    value /= 10;
+  } while (value);
+
+  for (size_t i = 0; i < count; i++)
+    buffer[i] = digits[count - 1 - i];
+  return count;
+}
+
+// the sgr parameters of every indexed color, e.g. "38;5;123"
+struct Fragment
+{
+  char text[8];
+  unsigned char size;
+};
+
+typedef Fragment FragmentTable[2][256]; // [foreground][index]
+
+static const FragmentTable& indexed_fragments()
 {
-  stringstream ss;
-  ss << (foreground ? "3" : "4") << "8;5;" << (int)oc_to_ansi[deflated_rgb];
-  return ss.str();
+  static FragmentTable table;
+  static bool built = [] {
+    for (int fg = 0; fg < 2; fg++)
+    {
+      for (int index = 0; index < 256; index++)
+      {
+        Fragment& f = table[fg][index];
+        f.text[0] = fg ? '3' : '4';
+        std::memcpy(f.text + 1, "8;5;", 4);
+        f.size = 5 + format_uint(f.text + 5, index);
+      }
+    }
+    return true;
+  }();
+  (void)built;
+  return table;
 }
 
-string to_ansi_rgb(int rgb, bool foreground)
+// writes the sgr parameters for color to buffer (which must hold 16 bytes), returns the byte count
+static inline size_t format_color(char* buffer, uint32_t color, bool foreground)
 {
-  stringstream ss;
-  ss << (foreground ? "3" : "4") << "8;2;" << (int)((rgb >> 16) & 0xFF)
-    << ";" << (int)((rgb >> 8) & 0xFF) << ";" << (int)(rgb & 0xFF);
-  return ss.str();
+  if (color & Ansi::true_color)
+  {
+    size_t size = 0;
+    buffer[size++] = foreground ? '3' : '4';
+    std::memcpy(buffer + size, "8;2;", 4);
+    size += 4;
+    size += format_uint(buffer + size, (color >> 16) & 0xFF);
+    buffer[size++] = ';';
+    size += format_uint(buffer + size, (color >> 8) & 0xFF);
+    buffer[size++] = ';';
+    size += format_uint(buffer + size, color & 0xFF);
+    return size;
+  }
+
+  const Fragment& f = indexed_fragments()[foreground ? 1 : 0][color & 0xFF];
+  std::memcpy(buffer, f.text, f.size);
+  return f.size;
 }
 
-string to_ansi(const Color& col, bool foreground, ColorState& cst)
+uint32_t Ansi::resolve(const Color& col, const ColorState& cst)
 {
   if (col.paletted)
   {
-    return to_ansi_rgb(cst.palette[col.rgb], foreground);
-  } else {
-    return to_ansi_deflated(col.code, foreground);
+    return Ansi::true_color | (cst.palette[col.rgb] & 0xFFFFFF);
   }
+  return oc_to_ansi[col.code & 0xFF];
 }
 
 string Ansi::set_color(const Color& fg, const Color& bg, ColorState& cst)
 {
-  string fg_txt = to_ansi(fg, true, cst);
-  string bg_txt = to_ansi(bg, false, cst);
+  return set_color(resolve(fg, cst), resolve(bg, cst));
+}
 
-  return esc + fg_txt + ";" + bg_txt + "m";
+string Ansi::set_color(uint32_t fg, uint32_t bg)
+{
+  string text;
+  append_color(text, fg, bg);
+  return text;
 }
 
 string Ansi::set_pos(int x, int y)
 {
-  stringstream ss;
-  ss << esc << y << ";" << x << "f";
-  return ss.str();
+  string text;
+  append_pos(text, x, y);
+  return text;
+}
+
+string Ansi::move_right(int count)
+{
+  string text;
+  append_move_right(text, count);
+  return text;
+}
+
+void Ansi::append_color(string& out, uint32_t fg, uint32_t bg)
+{
+  char buffer[40];
+  size_t size = 0;
+  buffer[size++] = ESC;
+  buffer[size++] = '[';
+  size += format_color(buffer + size, fg, true);
+  buffer[size++] = ';';
+  size += format_color(buffer + size, bg, false);
+  buffer[size++] = 'm';
+  out.append(buffer, size);
+}
+
+void Ansi::append_pos(string& out, int x, int y)
+{
+  char buffer[24];
+  size_t size = 0;
+  buffer[size++] = ESC;
+  buffer[size++] = '[';
+  size += format_uint(buffer + size, std::max(0, y));
+  buffer[size++] = ';';
+  size += format_uint(buffer + size, std::max(0, x));
+  buffer[size++] = 'f';
+  out.append(buffer, size);
+}
+
+void Ansi::append_move_right(string& out, int count)
+{
+  char buffer[16];
+  size_t size = 0;
+  buffer[size++] = ESC;
+  buffer[size++] = '[';
+  size += format_uint(buffer + size, std::max(0, count));
+  buffer[size++] = 'C';
+  out.append(buffer, size);
 }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "color/color_types.h"
+#include <cstdint>
 #include <string>
 #include <vector>
 using std::string;
@@ -28,6 +29,19 @@ static const string save_pos = esc + "s";
 static const string restore_pos = esc + "u";
 static const string color_reset = esc + "0m";
 
+// a color resolved for the terminal, either an xterm 256 color index or true_color | rgb
+// resolved colors do not depend on the color state anymore, renderers can keep them
+static const uint32_t true_color = 0x1000000;
+uint32_t resolve(const Color& col, const ColorState& cst);
+
 string set_color(const Color& fg, const Color& bg, ColorState& cst);
+string set_color(uint32_t fg, uint32_t bg);
 string set_pos(int x, int y);
+string move_right(int count);
+
+// these append to out without allocating (beyond growing out)
+// renderers reuse one output string for a whole frame
+void append_color(string& out, uint32_t fg, uint32_t bg);
+void append_pos(string& out, int x, int y);
+void append_move_right(string& out, int count);
 };
@@ -1,6 +1,8 @@
 #include "ansi_escape.h"
 #include "model/log.h"
 
+#include <algorithm>
+#include <cerrno>
 #include <iostream>
 using std::cout;
 using std::flush;
@@ -55,19 +57,34 @@ AnsiEscapeTerm::~AnsiEscapeTerm()
 void AnsiEscapeTerm::onUpdate()
 {
 #ifndef __APPLE__
-  timespec timeout{ 0, 0 };                                   // poll, do not block
-  if (sigtimedwait(&g_sigset, nullptr, &timeout) == SIGWINCH) // winched
+  timespec timeout{ 0, 0 }; // poll, do not block
+  bool signaled = sigtimedwait(&g_sigset, nullptr, &timeout) == SIGWINCH;
+  if (_resized.exchange(false) || signaled)
   {
     cout << Ansi::clear_scroll << flush;
     auto rez = current_resolution();
     int width = std::get<0>(rez);
     int height = std::get<1>(rez);
     winched(width, height);
+    resizeBuffers(width, height);
   }
   cout << flush;
 #endif
 }
 
+void AnsiEscapeTerm::resized()
+{
+  _resized = true;
+  wake();
+}
+
+void AnsiEscapeTerm::onPresent()
+{
+  // anything streamed to cout goes out before the frame
+  cout << flush;
+  render();
+}
+
 tuple<int, int> AnsiEscapeTerm::onOpen()
 {
   //switch to alternative buffer screen
@@ -88,68 +105,156 @@ void AnsiEscapeTerm::onClose()
   cout << flush;
 }
 
-static string replace_all(const string& src, const string& match, const string& replacement)
+void AnsiEscapeTerm::resizeBuffers(int width, int height)
 {
-  size_t index = 0;
-  string result = "";
-  while (index < src.size())
+  vector<TermCell> back(width * height, TermCell{ ' ', unknown_color, unknown_color, 1 });
+  for (int y = 0; y < std::min(height, _rows); y++)
   {
-    size_t next = src.find(match, index);
-    result += src.substr(index, next - index);
-    index = next;
-    if (next != string::npos)
+    for (int x = 0; x < std::min(width, _cols); x++)
     {
-      result += replacement;
-      index += match.size() + 1;
-    }
-    else
-    {
-      // in case of signed size_t index is not >= src.size() here
-      break;
+      back[y * width + x] = _back[y * _cols + x];
     }
   }
-  return result;
+
+  _back.swap(back);
+  _front.resize(width * height);
+  _damage.resize(height, { 1, 0 });
+  _cols = width;
+  _rows = height;
+  forgetTerminal();
 }
 
-string AnsiEscapeTerm::scrub(const string& value) const
+void AnsiEscapeTerm::forgetTerminal()
 {
-  // replace tabs with (U+2409 for HT symbol)
-  // I could use the ht unicode symbol in the source file
-  // but i prefer to keep the source files in ascii
-  return replace_all(value, "\t", string{ (char)226, (char)144, (char)137, ' ' });
+  // no cell will match a codepoint of -1
+  std::fill(_front.begin(), _front.end(), TermCell{ 0xFFFFFFFF, unknown_color, unknown_color, 0 });
+  _fg = _bg = unknown_color;
 }
 
 void AnsiEscapeTerm::onWrite(int x, int y, const Cell& cell, ColorState& cst)
 {
-  string cmd = "";
-  if (x != _x || y != _y)
+  if (x > _cols || y > _rows)
+    resizeBuffers(std::max(x, _cols), std::max(y, _rows));
+
+  size_t index = (y - 1) * _cols + (x - 1);
+  _back[index] = {
+    cell.codepoint,
+    Ansi::resolve(cell.fg, cst),
+    Ansi::resolve(cell.bg, cst),
+    cell.width
+  };
+
+  // the right half of a wide glyph is locked and never written, mark it as covered
+  int last = x;
+  if (cell.width > 1 && x < _cols)
   {
-    if (x == 1 && y == _y + 1) // new line
+    _back[index + 1] = { 0, _back[index].fg, _back[index].bg, 0 };
+    last = x + 1;
+  }
+
+  auto& damage = _damage[y - 1];
+  if (damage.first > damage.second)
+  {
+    damage = { x, last };
+  }
+  else
+  {
+    damage.first = std::min(damage.first, x);
+    damage.second = std::max(damage.second, last);
+  }
+
+  _damaged = true;
+}
+
+void AnsiEscapeTerm::moveTo(int x, int y)
+{
+  if (x == _x && y == _y)
+    return;
+
+  if (x == 1 && y == _y + 1) // new line
+  {
+    _out += "\r\n";
+  }
+  else if (y == _y && x > _x)
+  {
+    Ansi::append_move_right(_out, x - _x);
+  }
+  else
+  {
+    Ansi::append_pos(_out, x, y);
+  }
+}
+
+void AnsiEscapeTerm::appendGlyph(uint32_t codepoint)
+{
+  if (codepoint == '\t')
+  {
+    // replace tabs with (U+2409 for HT symbol)
+    // I could use the ht unicode symbol in the source file
+    // but i prefer to keep the source files in ascii
+    _out += string{ (char)226, (char)144, (char)137, ' ' };
+    return;
+  }
+
+  char glyph[4];
+  _out.append(glyph, UnicodeApi::toutf8(codepoint, glyph));
+}
+
+void AnsiEscapeTerm::render()
+{
+  if (!_damaged)
+    return;
+  _damaged = false;
+
+  _out.clear();
+  for (int y = 1; y <= _rows; y++)
+  {
+    auto& damage = _damage[y - 1];
+    int last = std::min(damage.second, _cols);
+    for (int x = damage.first; x <= last; x++)
     {
-      cmd += "\r\n";
+      size_t index = (y - 1) * _cols + (x - 1);
+      const TermCell& cell = _back[index];
+      if (cell == _front[index])
+        continue;
+      _front[index] = cell;
+      if (cell.width == 0) // drawn with the wide glyph before it
+        continue;
+
+      moveTo(x, y);
+      if (cell.fg != _fg || cell.bg != _bg)
+      {
+        Ansi::append_color(_out, cell.fg, cell.bg);
+        _fg = cell.fg;
+        _bg = cell.bg;
+      }
+      appendGlyph(cell.codepoint);
+      _x = x + cell.width;
+      _y = y;
     }
-    else
+    damage = { 1, 0 };
+  }
+
+  const char* data = _out.data();
+  size_t left = _out.size();
+  while (left > 0)
+  {
+    ssize_t written = ::write(STDOUT_FILENO, data, left);
+    if (written < 0)
     {
-      cmd += Ansi::set_pos(x, y);
+      if (errno == EINTR)
+        continue;
+      break;
     }
+    data += written;
+    left -= written;
   }
-  if (cell.fg.rgb != _fg_rgb || cell.bg.rgb != _bg_rgb)
-    cmd += Ansi::set_color(cell.fg, cell.bg, cst);
-
-  string text = scrub(cell.value);
-  cout << cmd << text;
-  _x = x + cell.width;
-  _y = y;
-  _fg_rgb = cell.fg.rgb;
-  _bg_rgb = cell.bg.rgb;
-
-  // if _x or _y are outside the window, flush
-  auto rez = size();
-  if (_x > std::get<0>(rez) || _y > std::get<1>(rez))
-    cout << flush;
 }
 
 void AnsiEscapeTerm::onClear()
 {
   cout << Ansi::save_pos << Ansi::color_reset << Ansi::clear_term << Ansi::restore_pos << Ansi::set_pos(1, 1) << flush;
+  forgetTerminal();
+  _x = 1;
+  _y = 1;
 }
@@ -3,7 +3,15 @@
 #include "io/frame.h"
 #include "raw_tty.h"
 
+#include <atomic>
+#include <cstdint>
 #include <tuple>
+#include <utility>
+#include <vector>
+using std::vector;
+
+// columns and lines of the terminal on stdout
+tuple<int, int> current_resolution();
 
 class AnsiEscapeTerm : public Frame
 {
@@ -11,18 +19,54 @@ public:
   AnsiEscapeTerm();
   virtual ~AnsiEscapeTerm();
 
+  // called by the tty reader when the terminal size changed, the buffers follow on the next update
+  void resized();
+
 protected:
   void onWrite(int x, int y, const Cell& cell, ColorState& cst) override;
   virtual tuple<int, int> onOpen() override;
   void onUpdate() override;
+  void onPresent() override;
   void onClose() override;
   void onClear() override;
 
 private:
-  string scrub(const string& value) const;
+  // a cell as the terminal draws it, colors are resolved (see Ansi::resolve)
+  struct TermCell
+  {
+    uint32_t codepoint;
+    uint32_t fg;
+    uint32_t bg;
+    int width; // 0 for the right half of a wide glyph
+
+    bool operator==(const TermCell& other) const
+    {
+      return codepoint == other.codepoint && fg == other.fg && bg == other.bg && width == other.width;
+    }
+  };
 
+  void resizeBuffers(int width, int height);
+  void forgetTerminal(); // the terminal contents are unknown, redraw every damaged cell
+  void render();
+  void moveTo(int x, int y);
+  void appendGlyph(uint32_t codepoint);
+
+  // gpu writes land in _back and mark the row damaged
+  // once per update the damaged cells that differ from _front are drawn in one write
+  vector<TermCell> _back;
+  vector<TermCell> _front;
+  vector<std::pair<int, int>> _damage; // per row, first and last damaged column
+  bool _damaged = false;
+  std::atomic<bool> _resized{ false };
+  int _cols = 0;
+  int _rows = 0;
+  string _out;
+
+  // terminal cursor and colors after the last render
   int _x = 1;
   int _y = 1;
-  int _fg_rgb = 0;
-  int _bg_rgb = 0;
+  uint32_t _fg = unknown_color;
+  uint32_t _bg = unknown_color;
+
+  static const uint32_t unknown_color = 0xFFFFFFFF;
 };
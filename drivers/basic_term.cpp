@@ -1,9 +1,11 @@
 #include "basic_term.h"
+#include "apis/unicode.h"
 #include <iostream>
 
 void BasicTerm::onWrite(int x, int y, const Cell& cell, ColorState& cst)
 {
-  std::cout << cell.value;
+  char glyph[4];
+  std::cout.write(glyph, UnicodeApi::toutf8(cell.codepoint, glyph));
 }
 
 tuple<int, int> BasicTerm::onOpen()
@@ -10,6 +10,7 @@
 #include <sstream>
 
 using std::string;
+using std::string_view;
 using std::stringstream;
 using std::vector;
 
@@ -104,12 +105,17 @@ Connection::~Connection()
   close();
 }
 
-bool Connection::write(const vector<char>& vec)
+bool Connection::write(string_view data)
 {
   if (state() != ConnectionState::Ready)
     return false;
 
-  return ::send(_id, vec.data(), vec.size(), MSG_NOSIGNAL) != -1;
+  return ::send(_id, data.data(), data.size(), MSG_NOSIGNAL) != -1;
+}
+
+bool Connection::write(const vector<char>& vec)
+{
+  return write(string_view(vec.data(), vec.size()));
 }
 
 string Connection::label() const
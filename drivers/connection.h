@@ -1,6 +1,7 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <thread>
 #include <vector>
 
@@ -21,6 +22,7 @@ public:
   virtual ~Connection();
 
   bool readyNextPacket(std::vector<char>* buffer, bool keepPacketSize);
+  bool write(std::string_view data);
   bool write(const std::vector<char>& vec);
 
   std::string label() const;
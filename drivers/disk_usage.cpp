@@ -0,0 +1,190 @@
+#include "disk_usage.h"
+#include "drivers/fs_utils.h"
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+DiskUsage::~DiskUsage()
+{
+  close();
+}
+
+void DiskUsage::open(const string& root, bool watch)
+{
+  close();
+  _root = fs_utils::trim(root);
+
+#ifdef __linux__
+  if (watch)
+    _inotify = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+#endif
+
+  scan(_root);
+}
+
+void DiskUsage::close()
+{
+#ifdef __linux__
+  if (_inotify >= 0)
+  {
+    ::close(_inotify);
+    _inotify = -1;
+  }
+  _watches.clear();
+#endif
+
+  _files.clear();
+  _used = 0;
+}
+
+uint64_t DiskUsage::used() const
+{
+  return _used;
+}
+
+uint64_t DiskUsage::size(const string& path) const
+{
+  auto it = _files.find(fs_utils::trim(path));
+  return it == _files.end() ? 0 : it->second;
+}
+
+void DiskUsage::file(const string& path, uint64_t size)
+{
+  uint64_t& entry = _files[fs_utils::trim(path)];
+  _used = _used - entry + size;
+  entry = size;
+}
+
+void DiskUsage::removed(const string& path)
+{
+  string key = fs_utils::trim(path);
+  auto it = _files.find(key);
+  if (it != _files.end())
+  {
+    _used -= it->second;
+    _files.erase(it);
+  }
+
+  auto range = fs_utils::under(_files, key);
+  for (auto sub = range.first; sub != range.second; ++sub)
+    _used -= sub->second;
+  _files.erase(range.first, range.second);
+}
+
+void DiskUsage::renamed(const string& from, const string& to)
+{
+  string from_key = fs_utils::trim(from);
+  string to_key = fs_utils::trim(to);
+  if (from_key == to_key)
+    return;
+
+  map<string, uint64_t> moved;
+  auto it = _files.find(from_key);
+  if (it != _files.end())
+    moved[to_key] = it->second;
+  auto range = fs_utils::under(_files, from_key);
+  for (auto sub = range.first; sub != range.second; ++sub)
+    moved[to_key + sub->first.substr(from_key.size())] = sub->second;
+
+  removed(from_key);
+  removed(to_key);
+  for (const auto& entry : moved)
+    file(entry.first, entry.second);
+}
+
+void DiskUsage::scan(const string& path)
+{
+  if (!fs_utils::isDirectory(path))
+  {
+    file(path, fs_utils::size(path));
+    return;
+  }
+
+#ifdef __linux__
+  watch(path);
+#endif
+
+  for (const auto& child : fs_utils::list(path))
+    scan(child);
+}
+
+#ifdef __linux__
+void DiskUsage::watch(const string& dir)
+{
+  if (_inotify < 0)
+    return;
+
+  // a directory that moved keeps its descriptor, and gets its new path here
+  int wd = ::inotify_add_watch(_inotify, dir.c_str(), IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_ATTRIB);
+  if (wd >= 0)
+    _watches[wd] = dir;
+}
+#endif
+
+void DiskUsage::poll(const std::function<void(const string&)>& changed)
+{
+#ifdef __linux__
+  if (_inotify < 0)
+    return;
+
+  alignas(struct inotify_event) char buffer[4096];
+  while (true)
+  {
+    ssize_t bytes = ::read(_inotify, buffer, sizeof(buffer));
+    if (bytes <= 0)
+      return;
+
+    for (char* p = buffer; p < buffer + bytes;)
+    {
+      const auto* ev = reinterpret_cast<const struct inotify_event*>(p);
+      p += sizeof(struct inotify_event) + ev->len;
+
+      if (ev->mask & IN_Q_OVERFLOW)
+      {
+        // events were lost, start over
+        string root = _root;
+        open(root, true);
+        if (changed)
+          changed(root);
+        return;
+      }
+
+      if (ev->mask & IN_IGNORED)
+      {
+        _watches.erase(ev->wd);
+        continue;
+      }
+
+      auto it = _watches.find(ev->wd);
+      if (it == _watches.end() || ev->len == 0)
+        continue;
+      string path = it->second + "/" + ev->name;
+      if (changed)
+        changed(path);
+
+      if (ev->mask & (IN_DELETE | IN_MOVED_FROM))
+      {
+        removed(path);
+      }
+      else if (ev->mask & IN_MOVED_TO)
+      {
+        scan(path);
+      }
+      else if (ev->mask & IN_CREATE)
+      {
+        // a file being written here already has its size, don't roll it back to what is on disk
+        if (ev->mask & IN_ISDIR)
+          scan(path);
+        else if (_files.find(path) == _files.end())
+          file(path, fs_utils::size(path));
+      }
+      else if (ev->mask & IN_CLOSE_WRITE)
+      {
+        file(path, fs_utils::size(path));
+      }
+    }
+  }
+#endif
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <unordered_map>
+
+using std::map;
+using std::string;
+
+// The bytes used by the files under a directory, kept up to date without walking it again
+// The size of every file is recorded, so updates are idempotent: a change made through the
+// filesystem component and the watch event it raises later settle on the same total.
+// On linux, inotify reports the changes made by other programs, see poll().
+class DiskUsage
+{
+public:
+  DiskUsage() = default;
+  DiskUsage(const DiskUsage&) = delete;
+  DiskUsage& operator=(const DiskUsage&) = delete;
+  ~DiskUsage();
+
+  // walks root once, watch keeps following changes made outside the vm
+  void open(const string& root, bool watch);
+  void close();
+
+  uint64_t used() const;
+  // the recorded size of a file, 0 when unknown
+  uint64_t size(const string& path) const;
+
+  // paths are host paths under root
+  void file(const string& path, uint64_t size);
+  void removed(const string& path); // a file or a whole directory
+  void renamed(const string& from, const string& to);
+
+  // applies the changes made outside the vm since the last poll
+  // changed is called with each path that changed, or with root when events were lost
+  void poll(const std::function<void(const string&)>& changed = nullptr);
+
+private:
+  void scan(const string& path);
+
+  string _root;
+  map<string, uint64_t> _files; // ordered, a directory is a range of paths
+  uint64_t _used = 0;
+
+#ifdef __linux__
+  void watch(const string& dir);
+
+  int _inotify = -1;
+  std::unordered_map<int, string> _watches; // watch descriptor to directory
+#endif
+};
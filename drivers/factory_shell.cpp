@@ -1,5 +1,6 @@
 #include "ansi_escape.h"
 #include "basic_term.h"
+#include "headless_term.h"
 
 Frame* Factory::create_frame(const string& frameTypeName)
 {
@@ -11,6 +12,10 @@ Frame* Factory::create_frame(const string& frameTypeName)
   {
     return new AnsiEscapeTerm;
   }
+  else if (frameTypeName == "headless")
+  {
+    return new HeadlessTerm;
+  }
 
   return nullptr;
 }
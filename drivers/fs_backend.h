@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstdint>
+#include <ios>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using std::string;
+using std::string_view;
+using std::unique_ptr;
+using std::vector;
+
+// An open file of a filesystem backend
+class FsFile
+{
+public:
+  virtual ~FsFile() = default;
+
+  // the data is valid until the next call on the file
+  virtual string_view read(int32_t size)
+  {
+    return {};
+  }
+  // false when the backend has no space left for the data
+  virtual bool write(string_view data)
+  {
+    return false;
+  }
+  // false, and the position is kept, when the new position is not a valid offset
+  virtual bool seek(int32_t to, std::ios_base::seekdir way) = 0;
+  virtual int32_t tell() const = 0;
+  virtual bool eof() const
+  {
+    return false;
+  }
+};
+
+// The storage behind a filesystem component
+// Paths are absolute within the filesystem as the component cleans them, e.g. "/" or "/bin/sh.lua"
+class FsBackend
+{
+public:
+  enum class OpenMode
+  {
+    Read,
+    Write, // truncates
+    Append
+  };
+
+  virtual ~FsBackend() = default;
+
+  virtual bool isReadOnly() const = 0;
+  // nullptr when the path can't be opened in that mode
+  virtual unique_ptr<FsFile> open(const string& path, OpenMode mode) = 0;
+
+  virtual bool exists(const string& path) = 0;
+  virtual bool isDirectory(const string& path) = 0;
+  // the names in a directory, names of directories end with a slash
+  virtual vector<string> list(const string& path) = 0;
+  virtual uint64_t size(const string& path) = 0;
+  virtual uint64_t lastModified(const string& path) = 0; // seconds since the epoch
+
+  virtual bool makeDirectory(const string& path) = 0; // and its parents
+  virtual bool remove(const string& path) = 0; // a file, or a directory and all it contains
+  virtual bool rename(const string& from, const string& to) = 0;
+
+  virtual uint64_t spaceUsed() = 0;
+  virtual uint64_t spaceTotal() = 0; // 0 is unlimited
+
+  // runs every client step, e.g. to pick up changes made outside the vm
+  // steps can be far apart while the vm idles, nothing schedules one for this
+  virtual void update()
+  {
+  }
+};
@@ -138,7 +138,7 @@ bool fs_utils::copy(const string& src, const string& dst)
   return ec.value() == 0;
 }
 
-bool fs_utils::write(const vector<char>& data, const string& dst)
+bool fs_utils::write(string_view data, const string& dst)
 {
   ofstream file;
   file.open(resolve(dst));
@@ -153,8 +153,12 @@ bool fs_utils::write(const vector<char>& data, const string& dst)
 
 bool fs_utils::write(const string& data, const string& dst)
 {
-  vector<char> buffer{ data.begin(), data.end() };
-  return fs_utils::write(buffer, dst);
+  return fs_utils::write(string_view(data), dst);
+}
+
+bool fs_utils::write(const vector<char>& data, const string& dst)
+{
+  return fs_utils::write(string_view(data.data(), data.size()), dst);
 }
 
 bool fs_utils::mkdir(const string& path)
@@ -206,6 +210,11 @@ size_t fs_utils::size(const string& path, bool recursive)
     if (ec.value() != 0)
       result = 0;
   }
+  else if (recursive)
+  {
+    for (const auto& child : fs_utils::list(path))
+      result += fs_utils::size(child, true);
+  }
   return result;
 }
 
@@ -355,3 +364,34 @@ string fs_utils::filename(const string& path)
 {
   return fs::canonical(path).filename();
 }
+
+string fs_utils::trim(const string& path)
+{
+  if (path.size() > 1 && path.back() == '/')
+    return path.substr(0, path.size() - 1);
+  return path.empty() ? "/" : path;
+}
+
+vector<string> fs_utils::split_path(const string& path)
+{
+  vector<string> parts;
+  size_t begin = 0;
+  while (begin <= path.size())
+  {
+    size_t end = path.find('/', begin);
+    if (end == string::npos)
+      end = path.size();
+    string part = path.substr(begin, end - begin);
+    if (part == "..")
+    {
+      if (!parts.empty())
+        parts.pop_back();
+    }
+    else if (!part.empty() && part != ".")
+    {
+      parts.push_back(part);
+    }
+    begin = end + 1;
+  }
+  return parts;
+}
@@ -3,9 +3,12 @@
 #include <cstdint>
 #include <functional>
 #include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
 using std::function;
 using std::string;
+using std::string_view;
 using std::vector;
 
 namespace fs_utils
@@ -13,6 +16,7 @@ namespace fs_utils
 bool read(const string& path, vector<char>& outData);
 bool read(const string& path, string* pOutData = nullptr);
 bool copy(const string& src, const string& dst);
+bool write(string_view data, const string& dst);
 bool write(const string& data, const string& dst);
 bool write(const vector<char>& data, const string& dst);
 
@@ -36,4 +40,25 @@ string make_pwd_path(const string& given_path);
 void set_prog_name(const string& prog_name);
 
 string filename(const string& path);
+
+// drops a trailing slash, the root stays "/"
+string trim(const string& path);
+
+// the entries of an ordered map or set that lie under a directory, not the directory itself
+// everything under a directory sorts right after its path and a slash, and before its path and a '0'
+template <typename Container>
+std::pair<typename Container::iterator, typename Container::iterator> under(Container& entries, const string& path)
+{
+  return { entries.lower_bound(path + "/"), entries.lower_bound(path + "0") };
+}
+
+template <typename Container>
+void erase_under(Container& entries, const string& path)
+{
+  auto range = under(entries, path);
+  entries.erase(range.first, range.second);
+}
+
+// the parts of a path inside a filesystem, empty and . parts are dropped, .. can't leave the root
+vector<string> split_path(const string& path);
 };
@@ -0,0 +1,11 @@
+#include "headless_term.h"
+
+void HeadlessTerm::onWrite(int x, int y, const Cell& cell, ColorState& cst)
+{
+}
+
+tuple<int, int> HeadlessTerm::onOpen()
+{
+  // the largest tier 3 resolution
+  return std::make_tuple(160, 50);
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+#include "io/frame.h"
+
+// a frame without a terminal, for vms that run unattended
+// (e.g. several vms sharing one ocvm process)
+class HeadlessTerm : public Frame
+{
+protected:
+  void onWrite(int x, int y, const Cell& cell, ColorState& cst) override;
+  tuple<int, int> onOpen() override;
+};
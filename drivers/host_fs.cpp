@@ -0,0 +1,375 @@
+#include "host_fs.h"
+#include "drivers/fs_utils.h"
+
+#include <algorithm>
+#include <fcntl.h>
+#include <fstream>
+#include <limits>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+using std::numeric_limits;
+
+class HostFileReader : public FsFile
+{
+public:
+  // files of read only filesystems from this size up are mapped instead of read
+  static const int32_t map_threshold = 64 * 1024;
+
+  HostFileReader(const string& hostpath, bool readOnly)
+  {
+    _fd = ::open(hostpath.c_str(), O_RDONLY);
+    if (_fd < 0)
+      return;
+
+    struct stat st;
+    if (::fstat(_fd, &st) != 0 || S_ISDIR(st.st_mode))
+    {
+      ::close(_fd);
+      _fd = -1;
+      return;
+    }
+    _size = static_cast<int32_t>(std::min<off_t>(st.st_size, numeric_limits<int32_t>::max()));
+
+    // loot files can't change under us, read them straight from the page cache
+    if (readOnly && _size >= map_threshold)
+    {
+      void* p = ::mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, _fd, 0);
+      if (p != MAP_FAILED)
+        _map = static_cast<const char*>(p);
+    }
+  }
+
+  ~HostFileReader()
+  {
+    if (_map)
+      ::munmap(const_cast<char*>(_map), _size);
+    if (_fd >= 0)
+      ::close(_fd);
+  }
+
+  bool isOpen() const
+  {
+    return _fd >= 0;
+  }
+
+  bool seek(int32_t to, std::ios_base::seekdir way) override
+  {
+    int64_t position;
+    switch (way)
+    {
+    case std::ios_base::cur:
+      position = static_cast<int64_t>(_position) + to;
+      break;
+    case std::ios_base::beg:
+      position = to;
+      break;
+    case std::ios_base::end:
+    default:
+      position = static_cast<int64_t>(_size) + to;
+      break;
+    }
+
+    if (position < 0 || position > numeric_limits<int32_t>::max())
+      return false;
+
+    _position = static_cast<int32_t>(position);
+    return true;
+  }
+
+  int32_t tell() const override
+  {
+    return _position;
+  }
+
+  string_view read(int32_t size) override
+  {
+    size = std::min(size, _size - std::min(_position, _size));
+    if (size <= 0)
+      return {};
+
+    if (_map)
+    {
+      string_view data(_map + _position, size);
+      _position += size;
+      return data;
+    }
+
+    // the buffer is kept between reads, sequential reads of one size don't allocate
+    if (_buffer.size() < static_cast<size_t>(size))
+      _buffer.resize(size);
+    ssize_t bytes = ::pread(_fd, _buffer.data(), size, _position);
+    if (bytes <= 0)
+      return {};
+
+    _position += static_cast<int32_t>(bytes);
+    return string_view(_buffer.data(), bytes);
+  }
+
+  bool eof() const override
+  {
+    return _position >= _size;
+  }
+
+private:
+  int _fd = -1;
+  int32_t _position = 0;
+  int32_t _size = 0; // at open
+  const char* _map = nullptr;
+  vector<char> _buffer;
+};
+
+class HostFileWriter : public FsFile
+{
+public:
+  HostFileWriter(HostFs* fs, const string& hostpath, bool append)
+      : _fs(fs)
+      , _path(hostpath)
+      , _append(append)
+  {
+    _stream.open(hostpath, append ? std::ios_base::app : std::ios_base::out);
+    if (_stream.is_open())
+    {
+      // opening may have truncated the file
+      _fs->track(_path);
+      _size = fs_utils::size(_path);
+    }
+  }
+
+  ~HostFileWriter()
+  {
+    if (_stream.is_open())
+    {
+      _stream.close();
+      _fs->track(_path);
+    }
+  }
+
+  bool isOpen() const
+  {
+    return _stream.is_open();
+  }
+
+  bool write(string_view data) override
+  {
+    int64_t end = static_cast<int64_t>(_append ? _size : std::max(tell(), 0)) + data.size();
+    uint64_t size = std::max(_size, static_cast<uint64_t>(end));
+    if (size > _size)
+    {
+      if (!_fs->reserve(_path, size))
+        return false;
+      _size = size;
+    }
+
+    _stream.write(data.data(), data.size());
+    return true;
+  }
+
+  bool seek(int32_t to, std::ios_base::seekdir way) override
+  {
+    // we may have read past the eof
+    _stream.clear();
+
+    _stream.seekp(to, way);
+
+    if (_stream.fail() || _stream.bad())
+    {
+      _stream.clear();
+      return false;
+    }
+
+    return true;
+  }
+
+  int32_t tell() const override
+  {
+    return static_cast<int32_t>(const_cast<std::ofstream&>(_stream).tellp());
+  }
+
+private:
+  HostFs* _fs;
+  std::ofstream _stream;
+  string _path;
+  bool _append;
+  uint64_t _size = 0; // as accounted by the filesystem
+};
+
+HostFs::HostFs(const string& root, bool readOnly, uint64_t capacity)
+    : _root(root)
+    , _readOnly(readOnly)
+    , _capacity(capacity)
+{
+  if (!_root.empty() && _root.back() == '/')
+    _root.pop_back();
+
+  // loot is never written, it only needs counting once
+  _usage.open(_root, !_readOnly);
+}
+
+string HostFs::host(const string& path) const
+{
+  // one host path per file, the usage and the cache are keyed by it
+  string result = _root;
+  for (const auto& part : fs_utils::split_path(path))
+  {
+    result += "/";
+    result += part;
+  }
+  return result;
+}
+
+StatCache::Stat HostFs::stat(const string& hostpath)
+{
+  StatCache::Stat result;
+  if (_cache.stat(hostpath, &result))
+    return result;
+
+  // one syscall answers exists, isDirectory, size and lastModified
+  struct stat st;
+  if (::stat(hostpath.c_str(), &st) == 0)
+  {
+    result.exists = true;
+    result.directory = S_ISDIR(st.st_mode);
+    result.size = result.directory ? 0 : st.st_size;
+    result.modified = st.st_mtime;
+  }
+  _cache.stat(hostpath, result);
+  return result;
+}
+
+bool HostFs::isReadOnly() const
+{
+  return _readOnly;
+}
+
+unique_ptr<FsFile> HostFs::open(const string& path, OpenMode mode)
+{
+  string hostpath = host(path);
+  if (mode == OpenMode::Read)
+  {
+    unique_ptr<HostFileReader> reader(new HostFileReader(hostpath, _readOnly));
+    if (!reader->isOpen())
+      return nullptr;
+    return reader;
+  }
+
+  if (_readOnly || fs_utils::isDirectory(hostpath))
+    return nullptr;
+
+  unique_ptr<HostFileWriter> writer(new HostFileWriter(this, hostpath, mode == OpenMode::Append));
+  if (!writer->isOpen())
+    return nullptr;
+  return writer;
+}
+
+bool HostFs::exists(const string& path)
+{
+  update();
+  return stat(host(path)).exists;
+}
+
+bool HostFs::isDirectory(const string& path)
+{
+  update();
+  return stat(host(path)).directory;
+}
+
+vector<string> HostFs::list(const string& path)
+{
+  update();
+  string hostpath = host(path);
+  vector<string> names;
+  if (_cache.list(hostpath, &names))
+    return names;
+
+  for (const auto& item : fs_utils::list(hostpath))
+  {
+    // listing a directory is usually followed by looking at what is in it
+    string name = item.substr(item.find_last_of('/') + 1);
+    if (stat(item).directory)
+      name += "/";
+    names.push_back(name);
+  }
+  _cache.list(hostpath, names);
+  return names;
+}
+
+uint64_t HostFs::size(const string& path)
+{
+  update();
+  return stat(host(path)).size;
+}
+
+uint64_t HostFs::lastModified(const string& path)
+{
+  update();
+  return stat(host(path)).modified;
+}
+
+bool HostFs::makeDirectory(const string& path)
+{
+  string hostpath = host(path);
+  if (_readOnly || !fs_utils::mkdir(hostpath))
+    return false;
+  _cache.invalidate(hostpath);
+  return true;
+}
+
+bool HostFs::remove(const string& path)
+{
+  string hostpath = host(path);
+  if (_readOnly || !fs_utils::remove(hostpath))
+    return false;
+  _usage.removed(hostpath);
+  _cache.invalidate(hostpath);
+  return true;
+}
+
+bool HostFs::rename(const string& from, const string& to)
+{
+  string hostfrom = host(from);
+  string hostto = host(to);
+  if (_readOnly || !fs_utils::rename(hostfrom, hostto))
+    return false;
+  _usage.renamed(hostfrom, hostto);
+  _cache.invalidate(hostfrom);
+  _cache.invalidate(hostto);
+  return true;
+}
+
+uint64_t HostFs::spaceUsed()
+{
+  update();
+  return _usage.used();
+}
+
+uint64_t HostFs::spaceTotal()
+{
+  if (_readOnly && _capacity == 0) // loot is full
+    return _usage.used();
+  return _capacity;
+}
+
+void HostFs::update()
+{
+  // other programs changing the directory
+  // also run before answering from the cache, so the vm needs no timer to see the changes
+  _usage.poll([this](const string& hostpath) { _cache.invalidate(hostpath); });
+}
+
+bool HostFs::reserve(const string& hostpath, uint64_t size)
+{
+  uint64_t current = _usage.size(hostpath);
+  if (_capacity > 0 && size > current && _usage.used() + (size - current) > _capacity)
+    return false;
+
+  _usage.file(hostpath, size);
+  _cache.invalidate(hostpath);
+  return true;
+}
+
+void HostFs::track(const string& hostpath)
+{
+  _usage.file(hostpath, fs_utils::size(hostpath));
+  _cache.invalidate(hostpath);
+}
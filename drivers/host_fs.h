@@ -0,0 +1,48 @@
+#pragma once
+
+#include "disk_usage.h"
+#include "fs_backend.h"
+#include "stat_cache.h"
+
+// A filesystem backed by a directory of the host
+// Metadata is cached, the vm's changes and, for writable directories, inotify invalidate it.
+class HostFs : public FsBackend
+{
+public:
+  // a capacity of 0 is unlimited, a read only directory is never written or watched
+  HostFs(const string& root, bool readOnly, uint64_t capacity);
+
+  bool isReadOnly() const override;
+  unique_ptr<FsFile> open(const string& path, OpenMode mode) override;
+
+  bool exists(const string& path) override;
+  bool isDirectory(const string& path) override;
+  vector<string> list(const string& path) override;
+  uint64_t size(const string& path) override;
+  uint64_t lastModified(const string& path) override;
+
+  bool makeDirectory(const string& path) override;
+  bool remove(const string& path) override;
+  bool rename(const string& from, const string& to) override;
+
+  uint64_t spaceUsed() override;
+  uint64_t spaceTotal() override;
+
+  void update() override;
+
+  // host paths, for the files of this backend
+  // accounts for a file growing to size bytes, false when there is no space left for it
+  bool reserve(const string& hostpath, uint64_t size);
+  // records the size a file has on disk, e.g. once a writer closes it
+  void track(const string& hostpath);
+
+private:
+  string host(const string& path) const;
+  StatCache::Stat stat(const string& hostpath);
+
+  string _root;
+  bool _readOnly;
+  uint64_t _capacity;
+  DiskUsage _usage;
+  StatCache _cache;
+};
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+
+// Packed read only filesystem image, as written by tools/mkimage and read by ImageFs
+// file: ImageHeader, `entries` ImageEntries, the name table, then the file data at data_offset
+// all fields are little endian. Entries are sorted by (dir, name) compared bytewise, so a
+// path is found by binary search and the entries of one directory are contiguous.
+// Paths in the name table have no leading or trailing slash, the root directory is "".
+// File data is stored uncompressed, an open file reads straight from the mapped image.
+namespace ImageFormat
+{
+static const char magic[8] = { 'o', 'c', 'i', 'm', 'a', 'g', 'e', 1 };
+
+struct ImageHeader
+{
+  char magic[8];
+  uint32_t entries;
+  uint32_t names_size;  // bytes of the name table, which follows the entries
+  uint64_t data_offset; // from the start of the file
+  uint64_t data_size;
+};
+
+enum EntryFlags : uint32_t
+{
+  Directory = 1
+};
+
+struct ImageEntry
+{
+  uint32_t dir; // offset of the parent directory's path in the name table
+  uint32_t dir_size;
+  uint32_t name; // offset of the name in the name table
+  uint32_t name_size;
+  uint32_t flags;
+  uint32_t reserved;
+  uint64_t offset;   // of the file data, from data_offset
+  uint64_t size;     // bytes, 0 for directories
+  uint64_t modified; // unix time
+};
+};
@@ -0,0 +1,278 @@
+#include "image_fs.h"
+#include "drivers/fs_utils.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <limits>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+using namespace ImageFormat;
+using std::numeric_limits;
+
+class ImageFile : public FsFile
+{
+public:
+  explicit ImageFile(string_view data)
+      : _data(data)
+  {
+  }
+
+  string_view read(int32_t size) override
+  {
+    if (size <= 0 || eof())
+      return {};
+
+    string_view data = _data.substr(_position, size);
+    _position += static_cast<int32_t>(data.size());
+    return data;
+  }
+
+  bool seek(int32_t to, std::ios_base::seekdir way) override
+  {
+    int64_t position;
+    switch (way)
+    {
+    case std::ios_base::cur:
+      position = static_cast<int64_t>(_position) + to;
+      break;
+    case std::ios_base::beg:
+      position = to;
+      break;
+    case std::ios_base::end:
+    default:
+      position = static_cast<int64_t>(_data.size()) + to;
+      break;
+    }
+
+    if (position < 0 || position > numeric_limits<int32_t>::max())
+      return false;
+
+    _position = static_cast<int32_t>(position);
+    return true;
+  }
+
+  int32_t tell() const override
+  {
+    return _position;
+  }
+
+  bool eof() const override
+  {
+    return static_cast<size_t>(_position) >= _data.size();
+  }
+
+private:
+  string_view _data;
+  int32_t _position = 0;
+};
+
+ImageFs::ImageFs(const string& image)
+{
+  int fd = ::open(image.c_str(), O_RDONLY);
+  if (fd < 0)
+    return;
+
+  struct stat st;
+  if (::fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0)
+  {
+    void* p = ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (p != MAP_FAILED)
+    {
+      _map = static_cast<const char*>(p);
+      _size = st.st_size;
+      _modified = st.st_mtime;
+    }
+  }
+  // the mapping keeps the file open
+  ::close(fd);
+
+  if (_map && !load())
+  {
+    ::munmap(const_cast<char*>(_map), _size);
+    _map = nullptr;
+  }
+}
+
+ImageFs::~ImageFs()
+{
+  if (_map)
+    ::munmap(const_cast<char*>(_map), _size);
+}
+
+bool ImageFs::load()
+{
+  ImageHeader header;
+  if (_size < sizeof(header))
+    return false;
+  std::memcpy(&header, _map, sizeof(header));
+  if (std::memcmp(header.magic, ImageFormat::magic, sizeof(header.magic)) != 0)
+    return false;
+
+  uint64_t names_offset = sizeof(header) + static_cast<uint64_t>(header.entries) * sizeof(Entry);
+  if (names_offset + header.names_size > header.data_offset || header.data_offset > _size || header.data_size > _size - header.data_offset)
+    return false;
+
+  _entries = reinterpret_cast<const Entry*>(_map + sizeof(header));
+  _end = _entries + header.entries;
+  _names = _map + names_offset;
+  _names_size = header.names_size;
+  _data = _map + header.data_offset;
+  _data_size = header.data_size;
+
+  // checked once here, lookups trust the index afterwards
+  for (const Entry* entry = _entries; entry != _end; entry++)
+  {
+    if (static_cast<uint64_t>(entry->dir) + entry->dir_size > _names_size || static_cast<uint64_t>(entry->name) + entry->name_size > _names_size)
+      return false;
+    if (entry->offset > _data_size || entry->size > _data_size - entry->offset)
+      return false;
+    if (entry != _entries)
+    {
+      const Entry& prev = *(entry - 1);
+      if (std::make_pair(dir(prev), name(prev)) >= std::make_pair(dir(*entry), name(*entry)))
+        return false;
+    }
+  }
+  return true;
+}
+
+bool ImageFs::isOpen() const
+{
+  return _map != nullptr;
+}
+
+string_view ImageFs::dir(const Entry& entry) const
+{
+  return string_view(_names + entry.dir, entry.dir_size);
+}
+
+string_view ImageFs::name(const Entry& entry) const
+{
+  return string_view(_names + entry.name, entry.name_size);
+}
+
+string ImageFs::canonical(const string& path)
+{
+  string result;
+  for (const auto& part : fs_utils::split_path(path))
+  {
+    if (!result.empty())
+      result += "/";
+    result += part;
+  }
+  return result;
+}
+
+std::pair<string_view, string_view> ImageFs::key(string_view path)
+{
+  size_t slash = path.find_last_of('/');
+  if (slash == string_view::npos)
+    return { string_view(), path };
+  return { path.substr(0, slash), path.substr(slash + 1) };
+}
+
+const ImageFs::Entry* ImageFs::find(const string& path) const
+{
+  string p = canonical(path);
+  auto wanted = key(p);
+  const Entry* it = std::lower_bound(_entries, _end, wanted, [this](const Entry& entry, const std::pair<string_view, string_view>& k) {
+    return std::make_pair(dir(entry), name(entry)) < k;
+  });
+  if (it == _end || dir(*it) != wanted.first || name(*it) != wanted.second)
+    return nullptr;
+  return it;
+}
+
+bool ImageFs::isReadOnly() const
+{
+  return true;
+}
+
+unique_ptr<FsFile> ImageFs::open(const string& path, OpenMode mode)
+{
+  if (mode != OpenMode::Read)
+    return nullptr;
+
+  const Entry* entry = find(path);
+  if (!entry || (entry->flags & Directory))
+    return nullptr;
+
+  uint64_t size = std::min<uint64_t>(entry->size, numeric_limits<int32_t>::max());
+  return unique_ptr<FsFile>(new ImageFile(string_view(_data + entry->offset, size)));
+}
+
+bool ImageFs::exists(const string& path)
+{
+  return canonical(path).empty() || find(path);
+}
+
+bool ImageFs::isDirectory(const string& path)
+{
+  if (canonical(path).empty())
+    return true;
+  const Entry* entry = find(path);
+  return entry && (entry->flags & Directory);
+}
+
+vector<string> ImageFs::list(const string& path)
+{
+  vector<string> names;
+  if (!isDirectory(path))
+    return names;
+
+  string parent = canonical(path);
+  // the entries of a directory are contiguous in the index
+  const Entry* first = std::lower_bound(_entries, _end, parent, [this](const Entry& entry, string_view d) { return dir(entry) < d; });
+  const Entry* last = std::upper_bound(first, _end, parent, [this](string_view d, const Entry& entry) { return d < dir(entry); });
+
+  for (const Entry* entry = first; entry != last; entry++)
+  {
+    string item(name(*entry));
+    if (entry->flags & Directory)
+      item += "/";
+    names.push_back(item);
+  }
+  return names;
+}
+
+uint64_t ImageFs::size(const string& path)
+{
+  const Entry* entry = find(path);
+  return entry ? entry->size : 0;
+}
+
+uint64_t ImageFs::lastModified(const string& path)
+{
+  if (canonical(path).empty())
+    return _modified;
+  const Entry* entry = find(path);
+  return entry ? entry->modified : 0;
+}
+
+bool ImageFs::makeDirectory(const string& path)
+{
+  return false;
+}
+
+bool ImageFs::remove(const string& path)
+{
+  return false;
+}
+
+bool ImageFs::rename(const string& from, const string& to)
+{
+  return false;
+}
+
+uint64_t ImageFs::spaceUsed()
+{
+  return _data_size;
+}
+
+uint64_t ImageFs::spaceTotal()
+{
+  // images are full, like loot
+  return _data_size;
+}
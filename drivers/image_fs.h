@@ -0,0 +1,59 @@
+#pragma once
+
+#include "fs_backend.h"
+#include "image_format.h"
+
+#include <utility>
+
+// A read only filesystem served from a packed image, see image_format.h
+// The image is mapped as a whole, lookups search the sorted index in memory and
+// reads hand out views of the mapping, nothing touches the host filesystem after opening.
+class ImageFs : public FsBackend
+{
+public:
+  explicit ImageFs(const string& image);
+  ImageFs(const ImageFs&) = delete;
+  ImageFs& operator=(const ImageFs&) = delete;
+  ~ImageFs();
+
+  // false when the image could not be mapped or is malformed
+  bool isOpen() const;
+
+  bool isReadOnly() const override;
+  unique_ptr<FsFile> open(const string& path, OpenMode mode) override;
+
+  bool exists(const string& path) override;
+  bool isDirectory(const string& path) override;
+  vector<string> list(const string& path) override;
+  uint64_t size(const string& path) override;
+  uint64_t lastModified(const string& path) override;
+
+  bool makeDirectory(const string& path) override;
+  bool remove(const string& path) override;
+  bool rename(const string& from, const string& to) override;
+
+  uint64_t spaceUsed() override;
+  uint64_t spaceTotal() override;
+
+private:
+  using Entry = ImageFormat::ImageEntry;
+
+  bool load();
+  string_view dir(const Entry& entry) const;
+  string_view name(const Entry& entry) const;
+  // the path as the index stores it, e.g. "/lib/./core/" -> "lib/core", the root is empty
+  static string canonical(const string& path);
+  // the (dir, name) key of a canonical path, e.g. "lib/core" -> ("lib", "core")
+  static std::pair<string_view, string_view> key(string_view path);
+  const Entry* find(const string& path) const;
+
+  const char* _map = nullptr;
+  size_t _size = 0;
+  uint64_t _modified = 0; // of the image, for the root directory
+  const Entry* _entries = nullptr;
+  const Entry* _end = nullptr;
+  const char* _names = nullptr;
+  uint32_t _names_size = 0;
+  const char* _data = nullptr;
+  uint64_t _data_size = 0;
+};
@@ -83,6 +83,12 @@ bool InternetConnection::update()
   return updated;
 }
 
+bool InternetConnection::waiting() const
+{
+  auto state = connection()->state();
+  return (_needs_connection || _needs_data) && (state == ConnectionState::Starting || state == ConnectionState::Ready);
+}
+
 int InternetConnection::read(lua_State* lua)
 {
   _needs_data = true;
@@ -122,7 +128,7 @@ int TcpObject::write(lua_State* lua)
   if (!_connection->can_write())
     return ValuePack::ret(lua, Value::nil, "not connected");
 
-  vector<char> buffer = Value::checkArg<vector<char>>(lua, 1);
+  string_view buffer = Value::checkArg<string_view>(lua, 1);
   _connection->write(buffer);
   return ValuePack::ret(lua, buffer.size());
 }
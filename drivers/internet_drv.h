@@ -53,6 +53,8 @@ public:
   int close(lua_State* lua);
 
   virtual bool update();
+  // true while update may still find the connection ready or data arrived, the sockets are polled
+  virtual bool waiting() const;
 
   void setOnClose(InternetConnectionEventSet::OnClosedCallback cb);
 
@@ -277,6 +277,11 @@ bool HttpObject::update()
   return InternetConnection::update();
 }
 
+bool HttpObject::waiting() const
+{
+  return !_response_ready || InternetConnection::waiting();
+}
+
 Connection* HttpObject::connection() const
 {
   return _cmd.stdout();
@@ -30,6 +30,7 @@ public:
 
 protected:
   bool update() override;
+  bool waiting() const override;
   Connection* connection() const override;
 
 private:
@@ -0,0 +1,102 @@
+#include "mapped_file.h"
+#include "model/log.h"
+using Logging::lout;
+
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MappedFile::~MappedFile()
+{
+  close();
+}
+
+bool MappedFile::open(const string& path, size_t size)
+{
+  close();
+  if (size == 0)
+    return false;
+
+  _fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+  if (_fd < 0)
+  {
+    lout << "failed to open " << path << " for mapping\n";
+    return false;
+  }
+
+  struct stat st;
+  if (::fstat(_fd, &st) != 0 || (static_cast<size_t>(st.st_size) < size && ::ftruncate(_fd, size) != 0))
+  {
+    lout << "failed to size " << path << " to " << size << " bytes\n";
+    close();
+    return false;
+  }
+
+  // a store into a page the disk has no room for is a SIGBUS, the blocks are claimed up front instead
+  int err = ::posix_fallocate(_fd, 0, size);
+  if (err != 0)
+  {
+    lout << "failed to reserve " << size << " bytes for " << path << ": " << ::strerror(err) << "\n";
+    close();
+    return false;
+  }
+
+  void* p = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, _fd, 0);
+  if (p == MAP_FAILED)
+  {
+    lout << "failed to map " << path << "\n";
+    close();
+    return false;
+  }
+
+  _data = static_cast<char*>(p);
+  _size = size;
+  return true;
+}
+
+void MappedFile::close()
+{
+  if (_data)
+  {
+    ::msync(_data, _size, MS_SYNC);
+    ::munmap(_data, _size);
+    _data = nullptr;
+    _size = 0;
+  }
+
+  if (_fd >= 0)
+  {
+    ::close(_fd);
+    _fd = -1;
+  }
+}
+
+bool MappedFile::isOpen() const
+{
+  return _data != nullptr;
+}
+
+char* MappedFile::data() const
+{
+  return _data;
+}
+
+size_t MappedFile::size() const
+{
+  return _size;
+}
+
+bool MappedFile::sync(size_t offset, size_t length, bool wait)
+{
+  if (!_data || offset >= _size)
+    return false;
+
+  // msync takes page aligned addresses
+  static const size_t page = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+  size_t begin = offset - offset % page;
+  size_t end = std::min(offset + length, _size);
+  return ::msync(_data + begin, end - begin, wait ? MS_SYNC : MS_ASYNC) == 0;
+}
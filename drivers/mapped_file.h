@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+using std::size_t;
+using std::string;
+
+// A file mapped read/write into memory
+// Writes land in the page cache as they are made, so they survive a crash of the process,
+// sync() pushes them to the disk. The blocks are reserved when opening, so running out of
+// disk space fails open() rather than a later write.
+class MappedFile
+{
+public:
+  MappedFile() = default;
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+  ~MappedFile();
+
+  // maps the first size bytes of path, creating the file or growing it as needed
+  // false when the disk can't hold size bytes
+  // a longer file is not truncated, the bytes beyond size are left alone
+  bool open(const string& path, size_t size);
+  void close();
+  bool isOpen() const;
+
+  char* data() const;
+  size_t size() const;
+
+  // writes the pages covering [offset, offset + length) back to the file
+  // wait blocks until the disk has them, otherwise the write back is only scheduled
+  bool sync(size_t offset, size_t length, bool wait);
+
+private:
+  int _fd = -1;
+  char* _data = nullptr;
+  size_t _size = 0;
+};
@@ -0,0 +1,275 @@
+#include "overlay_fs.h"
+#include "drivers/fs_utils.h"
+
+#include <map>
+#include <sstream>
+
+// bytes per read when copying a file up into the delta
+static const int32_t copy_block = 64 * 1024;
+
+OverlayFs::OverlayFs(shared_ptr<FsBackend> base, unique_ptr<FsBackend> delta, const string& whiteout_path)
+    : _base(std::move(base))
+    , _delta(std::move(delta))
+    , _whiteout_path(whiteout_path)
+{
+  string data;
+  if (!_whiteout_path.empty() && fs_utils::read(_whiteout_path, &data))
+  {
+    std::stringstream ss(data);
+    string line;
+    while (std::getline(ss, line))
+    {
+      if (!line.empty())
+        _whiteouts.insert(line);
+    }
+  }
+}
+
+string OverlayFs::parent(const string& path)
+{
+  size_t slash = path.find_last_of('/');
+  return slash == 0 || slash == string::npos ? "/" : path.substr(0, slash);
+}
+
+string OverlayFs::child(const string& dir, const string& name)
+{
+  return dir == "/" ? dir + name : dir + "/" + name;
+}
+
+bool OverlayFs::hidden(const string& path) const
+{
+  if (_whiteouts.empty())
+    return false;
+
+  for (size_t i = 1; i <= path.size(); i++)
+  {
+    if ((i == path.size() || path[i] == '/') && _whiteouts.count(path.substr(0, i)))
+      return true;
+  }
+  return false;
+}
+
+bool OverlayFs::inBase(const string& path)
+{
+  return !hidden(path) && _base->exists(path);
+}
+
+void OverlayFs::reveal(const string& path)
+{
+  bool changed = false;
+  for (size_t i = 1; i <= path.size(); i++)
+  {
+    if (i != path.size() && path[i] != '/')
+      continue;
+
+    string prefix = path.substr(0, i);
+    if (!_whiteouts.erase(prefix))
+      continue;
+
+    // the path comes back empty, what the base has under it stays removed
+    changed = true;
+    if (_base->isDirectory(prefix))
+    {
+      for (const auto& name : _base->list(prefix))
+        _whiteouts.insert(child(prefix, fs_utils::trim(name)));
+    }
+  }
+
+  if (changed)
+    saveWhiteouts();
+}
+
+bool OverlayFs::prepare(const string& path)
+{
+  string dir = parent(path);
+  if (!isDirectory(dir))
+    return false;
+  return _delta->isDirectory(dir) || _delta->makeDirectory(dir);
+}
+
+bool OverlayFs::copy(const string& from, const string& to)
+{
+  if (isDirectory(from))
+  {
+    if (!_delta->isDirectory(to) && !_delta->makeDirectory(to))
+      return false;
+    for (const auto& name : list(from))
+    {
+      if (!copy(child(from, fs_utils::trim(name)), child(to, fs_utils::trim(name))))
+        return false;
+    }
+    return true;
+  }
+
+  unique_ptr<FsFile> source = open(from, OpenMode::Read);
+  unique_ptr<FsFile> target = _delta->open(to, OpenMode::Write);
+  if (!source || !target)
+    return false;
+
+  while (!source->eof())
+  {
+    string_view block = source->read(copy_block);
+    if (block.empty())
+      break;
+    if (!target->write(block))
+      return false;
+  }
+  return true;
+}
+
+void OverlayFs::saveWhiteouts() const
+{
+  if (_whiteout_path.empty())
+    return;
+
+  string data;
+  for (const auto& path : _whiteouts)
+  {
+    data += path;
+    data += "\n";
+  }
+  fs_utils::write(data, _whiteout_path);
+}
+
+bool OverlayFs::isReadOnly() const
+{
+  return false;
+}
+
+unique_ptr<FsFile> OverlayFs::open(const string& path, OpenMode mode)
+{
+  string p = fs_utils::trim(path);
+  if (mode == OpenMode::Read)
+  {
+    if (_delta->exists(p))
+      return _delta->open(p, mode);
+    if (inBase(p))
+      return _base->open(p, mode);
+    return nullptr;
+  }
+
+  if (isDirectory(p) || !prepare(p))
+    return nullptr;
+
+  if (mode == OpenMode::Append && !_delta->exists(p) && inBase(p) && !copy(p, p))
+    return nullptr;
+
+  reveal(p);
+  return _delta->open(p, mode);
+}
+
+bool OverlayFs::exists(const string& path)
+{
+  string p = fs_utils::trim(path);
+  return _delta->exists(p) || inBase(p);
+}
+
+bool OverlayFs::isDirectory(const string& path)
+{
+  string p = fs_utils::trim(path);
+  if (_delta->exists(p))
+    return _delta->isDirectory(p);
+  return inBase(p) && _base->isDirectory(p);
+}
+
+vector<string> OverlayFs::list(const string& path)
+{
+  string p = fs_utils::trim(path);
+  std::map<string, string> names; // sorted, by name without the slash of directories
+
+  bool in_delta = _delta->exists(p);
+  if (in_delta)
+  {
+    for (const auto& name : _delta->list(p))
+      names.emplace(fs_utils::trim(name), name);
+  }
+
+  // a file in the delta shadows a base directory of the same path
+  if ((!in_delta || _delta->isDirectory(p)) && inBase(p))
+  {
+    for (const auto& name : _base->list(p))
+    {
+      string key = fs_utils::trim(name);
+      if (!names.count(key) && !hidden(child(p, key)))
+        names.emplace(key, name);
+    }
+  }
+
+  vector<string> result;
+  for (const auto& entry : names)
+    result.push_back(entry.second);
+  return result;
+}
+
+uint64_t OverlayFs::size(const string& path)
+{
+  string p = fs_utils::trim(path);
+  if (_delta->exists(p))
+    return _delta->size(p);
+  return inBase(p) ? _base->size(p) : 0;
+}
+
+uint64_t OverlayFs::lastModified(const string& path)
+{
+  string p = fs_utils::trim(path);
+  if (_delta->exists(p))
+    return _delta->lastModified(p);
+  return inBase(p) ? _base->lastModified(p) : 0;
+}
+
+bool OverlayFs::makeDirectory(const string& path)
+{
+  string p = fs_utils::trim(path);
+  reveal(p);
+  return _delta->makeDirectory(p);
+}
+
+bool OverlayFs::remove(const string& path)
+{
+  string p = fs_utils::trim(path);
+  if (p == "/")
+    return false;
+
+  bool removed = _delta->exists(p) && _delta->remove(p);
+  if (inBase(p))
+  {
+    // one whiteout covers everything under the path
+    fs_utils::erase_under(_whiteouts, p);
+    _whiteouts.insert(p);
+    saveWhiteouts();
+    removed = true;
+  }
+  return removed;
+}
+
+bool OverlayFs::rename(const string& from, const string& to)
+{
+  string f = fs_utils::trim(from);
+  string t = fs_utils::trim(to);
+  if (f == "/" || !exists(f) || exists(t) || !prepare(t))
+    return false;
+
+  reveal(t);
+  if (!inBase(f))
+    return _delta->rename(f, t);
+
+  // the base can't move, copy what it shows and hide the original
+  return copy(f, t) && remove(f);
+}
+
+uint64_t OverlayFs::spaceUsed()
+{
+  return _base->spaceUsed() + _delta->spaceUsed();
+}
+
+uint64_t OverlayFs::spaceTotal()
+{
+  // the capacity limits the delta, the base comes on top
+  uint64_t total = _delta->spaceTotal();
+  return total > 0 ? _base->spaceUsed() + total : 0;
+}
+
+void OverlayFs::update()
+{
+  _delta->update();
+}
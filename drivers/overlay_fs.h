@@ -0,0 +1,58 @@
+#pragma once
+
+#include "fs_backend.h"
+
+#include <memory>
+#include <set>
+
+using std::set;
+using std::shared_ptr;
+
+// A writable filesystem layered over a read only base, the base is never written
+// Reads fall through to the base unless the delta has the path. Writing a base file copies
+// it up into the delta first, removing a base path records a whiteout that hides it.
+// Many overlays can share one base, e.g. vms booting off the same loot tree.
+class OverlayFs : public FsBackend
+{
+public:
+  // the whiteouts are kept in a host file, nothing is kept when whiteout_path is empty
+  OverlayFs(shared_ptr<FsBackend> base, unique_ptr<FsBackend> delta, const string& whiteout_path);
+
+  bool isReadOnly() const override;
+  unique_ptr<FsFile> open(const string& path, OpenMode mode) override;
+
+  bool exists(const string& path) override;
+  bool isDirectory(const string& path) override;
+  vector<string> list(const string& path) override;
+  uint64_t size(const string& path) override;
+  uint64_t lastModified(const string& path) override;
+
+  bool makeDirectory(const string& path) override;
+  bool remove(const string& path) override;
+  bool rename(const string& from, const string& to) override;
+
+  uint64_t spaceUsed() override;
+  uint64_t spaceTotal() override;
+
+  void update() override;
+
+private:
+  static string parent(const string& path);
+  static string child(const string& dir, const string& name);
+
+  // whether the base has the path and no whiteout covers it
+  bool inBase(const string& path);
+  bool hidden(const string& path) const;
+  // lifts the whiteouts on path and its parents, the base entries under them stay hidden
+  void reveal(const string& path);
+  // makes the directories of path down to its parent in the delta
+  bool prepare(const string& path);
+  // copies what the overlay shows at from into the delta at to
+  bool copy(const string& from, const string& to);
+  void saveWhiteouts() const;
+
+  shared_ptr<FsBackend> _base;
+  unique_ptr<FsBackend> _delta;
+  string _whiteout_path;
+  set<string> _whiteouts;
+};
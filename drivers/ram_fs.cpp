@@ -0,0 +1,327 @@
+#include "ram_fs.h"
+#include "drivers/fs_utils.h"
+
+#include <algorithm>
+#include <cstring>
+#include <ctime>
+#include <limits>
+using std::numeric_limits;
+using std::shared_ptr;
+
+class RamFile : public FsFile
+{
+public:
+  RamFile(RamFs* fs, shared_ptr<RamFs::Node> node, bool append)
+      : _fs(fs)
+      , _node(std::move(node))
+      , _append(append)
+  {
+  }
+
+  string_view read(int32_t size) override
+  {
+    uint64_t available = _node->size - std::min<uint64_t>(_position, _node->size);
+    size = static_cast<int32_t>(std::min<uint64_t>(std::max(size, 0), available));
+    if (size <= 0)
+      return {};
+
+    size_t chunk = _position / RamFs::chunk_size;
+    size_t offset = _position % RamFs::chunk_size;
+    _position += size;
+
+    // within one chunk the data is handed out as it is stored
+    if (offset + size <= RamFs::chunk_size)
+      return string_view(_node->chunks[chunk].get() + offset, size);
+
+    _buffer.resize(size);
+    for (size_t done = 0; done < static_cast<size_t>(size); chunk++, offset = 0)
+    {
+      size_t count = std::min(RamFs::chunk_size - offset, size - done);
+      std::memcpy(_buffer.data() + done, _node->chunks[chunk].get() + offset, count);
+      done += count;
+    }
+    return string_view(_buffer.data(), size);
+  }
+
+  bool write(string_view data) override
+  {
+    uint64_t start = _append ? _node->size : static_cast<uint64_t>(_position);
+    uint64_t end = start + data.size();
+    if (end > static_cast<uint64_t>(numeric_limits<int32_t>::max()))
+      return false;
+    if (end > _node->size && !_fs->resize(_node.get(), end))
+      return false;
+
+    size_t chunk = start / RamFs::chunk_size;
+    size_t offset = start % RamFs::chunk_size;
+    for (size_t done = 0; done < data.size(); chunk++, offset = 0)
+    {
+      size_t count = std::min(RamFs::chunk_size - offset, data.size() - done);
+      std::memcpy(_node->chunks[chunk].get() + offset, data.data() + done, count);
+      done += count;
+    }
+
+    _position = static_cast<int32_t>(end);
+    _node->modified = std::time(nullptr);
+    return true;
+  }
+
+  bool seek(int32_t to, std::ios_base::seekdir way) override
+  {
+    int64_t position;
+    switch (way)
+    {
+    case std::ios_base::cur:
+      position = static_cast<int64_t>(_position) + to;
+      break;
+    case std::ios_base::beg:
+      position = to;
+      break;
+    case std::ios_base::end:
+    default:
+      position = static_cast<int64_t>(_node->size) + to;
+      break;
+    }
+
+    if (position < 0 || position > numeric_limits<int32_t>::max())
+      return false;
+
+    _position = static_cast<int32_t>(position);
+    return true;
+  }
+
+  int32_t tell() const override
+  {
+    return _position;
+  }
+
+  bool eof() const override
+  {
+    return static_cast<uint64_t>(_position) >= _node->size;
+  }
+
+private:
+  RamFs* _fs;
+  shared_ptr<RamFs::Node> _node;
+  bool _append;
+  int32_t _position = 0;
+  vector<char> _buffer; // reads that span chunks
+};
+
+RamFs::RamFs(uint64_t capacity)
+    : _root(std::make_shared<Node>())
+    , _capacity(capacity)
+{
+  _root->directory = true;
+  _root->modified = std::time(nullptr);
+}
+
+shared_ptr<RamFs::Node> RamFs::find(const vector<string>& parts) const
+{
+  shared_ptr<Node> node = _root;
+  for (const auto& part : parts)
+  {
+    if (!node->directory)
+      return nullptr;
+    auto it = node->children.find(part);
+    if (it == node->children.end())
+      return nullptr;
+    node = it->second;
+  }
+  return node;
+}
+
+bool RamFs::resize(Node* file, uint64_t size)
+{
+  // a removed file still open is not counted, it is gone once closed
+  if (file->linked && size > file->size && _capacity > 0 && _used + (size - file->size) > _capacity)
+    return false;
+
+  size_t chunks = (size + chunk_size - 1) / chunk_size;
+  if (size < file->size)
+  {
+    file->chunks.resize(chunks);
+    // growing again must read zeros past the old end
+    if (size % chunk_size)
+      std::memset(file->chunks.back().get() + size % chunk_size, 0, chunk_size - size % chunk_size);
+  }
+  while (file->chunks.size() < chunks)
+    file->chunks.emplace_back(new char[chunk_size]());
+
+  if (file->linked)
+    _used = _used - file->size + size;
+  file->size = size;
+  file->modified = std::time(nullptr);
+  return true;
+}
+
+uint64_t RamFs::release(Node* node)
+{
+  // the data stays for the handles still open, the last one frees it
+  uint64_t bytes = node->size;
+  for (auto& child : node->children)
+    bytes += release(child.second.get());
+  node->linked = false;
+  return bytes;
+}
+
+bool RamFs::isReadOnly() const
+{
+  return false;
+}
+
+unique_ptr<FsFile> RamFs::open(const string& path, OpenMode mode)
+{
+  vector<string> parts = fs_utils::split_path(path);
+  if (parts.empty())
+    return nullptr;
+
+  shared_ptr<Node> node = find(parts);
+  if (mode == OpenMode::Read)
+  {
+    if (!node || node->directory)
+      return nullptr;
+    return unique_ptr<FsFile>(new RamFile(this, node, false));
+  }
+
+  if (!node)
+  {
+    string name = parts.back();
+    parts.pop_back();
+    shared_ptr<Node> parent = find(parts);
+    if (!parent || !parent->directory)
+      return nullptr;
+
+    node = std::make_shared<Node>();
+    node->modified = std::time(nullptr);
+    parent->children[name] = node;
+  }
+  else if (node->directory)
+  {
+    return nullptr;
+  }
+  else if (mode == OpenMode::Write)
+  {
+    resize(node.get(), 0);
+  }
+
+  return unique_ptr<FsFile>(new RamFile(this, node, mode == OpenMode::Append));
+}
+
+bool RamFs::exists(const string& path)
+{
+  return find(fs_utils::split_path(path)) != nullptr;
+}
+
+bool RamFs::isDirectory(const string& path)
+{
+  auto node = find(fs_utils::split_path(path));
+  return node && node->directory;
+}
+
+vector<string> RamFs::list(const string& path)
+{
+  vector<string> names;
+  auto node = find(fs_utils::split_path(path));
+  if (!node)
+    return names;
+
+  for (const auto& child : node->children)
+    names.push_back(child.second->directory ? child.first + "/" : child.first);
+  return names;
+}
+
+uint64_t RamFs::size(const string& path)
+{
+  auto node = find(fs_utils::split_path(path));
+  return node && !node->directory ? node->size : 0;
+}
+
+uint64_t RamFs::lastModified(const string& path)
+{
+  auto node = find(fs_utils::split_path(path));
+  return node ? node->modified : 0;
+}
+
+bool RamFs::makeDirectory(const string& path)
+{
+  shared_ptr<Node> node = _root;
+  for (const auto& part : fs_utils::split_path(path))
+  {
+    auto& child = node->children[part];
+    if (!child)
+    {
+      child = std::make_shared<Node>();
+      child->directory = true;
+      child->modified = std::time(nullptr);
+    }
+    else if (!child->directory)
+    {
+      return false;
+    }
+    node = child;
+  }
+  return true;
+}
+
+bool RamFs::remove(const string& path)
+{
+  vector<string> parts = fs_utils::split_path(path);
+  if (parts.empty())
+    return false;
+
+  string name = parts.back();
+  parts.pop_back();
+  auto parent = find(parts);
+  if (!parent || !parent->directory)
+    return false;
+
+  auto it = parent->children.find(name);
+  if (it == parent->children.end())
+    return false;
+
+  _used -= release(it->second.get());
+  parent->children.erase(it);
+  parent->modified = std::time(nullptr);
+  return true;
+}
+
+bool RamFs::rename(const string& from, const string& to)
+{
+  vector<string> from_parts = fs_utils::split_path(from);
+  vector<string> to_parts = fs_utils::split_path(to);
+  if (from_parts.empty() || to_parts.empty())
+    return false;
+  // a directory can't move into itself
+  if (to_parts.size() >= from_parts.size() && std::equal(from_parts.begin(), from_parts.end(), to_parts.begin()))
+    return false;
+
+  string from_name = from_parts.back();
+  from_parts.pop_back();
+  string to_name = to_parts.back();
+  to_parts.pop_back();
+
+  auto from_parent = find(from_parts);
+  auto to_parent = find(to_parts);
+  if (!from_parent || !to_parent || !to_parent->directory || to_parent->children.count(to_name))
+    return false;
+
+  auto it = from_parent->children.find(from_name);
+  if (it == from_parent->children.end())
+    return false;
+
+  to_parent->children[to_name] = it->second;
+  from_parent->children.erase(it);
+  from_parent->modified = to_parent->modified = std::time(nullptr);
+  return true;
+}
+
+uint64_t RamFs::spaceUsed()
+{
+  return _used;
+}
+
+uint64_t RamFs::spaceTotal()
+{
+  return _capacity;
+}
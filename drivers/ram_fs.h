@@ -0,0 +1,54 @@
+#pragma once
+
+#include "fs_backend.h"
+
+#include <map>
+
+// A filesystem kept in memory, e.g. the tmpfs, gone when the backend is destroyed
+// Files are stored in fixed size chunks so growing one never moves what it already holds.
+class RamFs : public FsBackend
+{
+public:
+  // oc's default tmpfs size
+  static const uint64_t default_capacity = 64 * 1024;
+  static const size_t chunk_size = 4096;
+
+  explicit RamFs(uint64_t capacity = default_capacity);
+
+  bool isReadOnly() const override;
+  unique_ptr<FsFile> open(const string& path, OpenMode mode) override;
+
+  bool exists(const string& path) override;
+  bool isDirectory(const string& path) override;
+  vector<string> list(const string& path) override;
+  uint64_t size(const string& path) override;
+  uint64_t lastModified(const string& path) override;
+
+  bool makeDirectory(const string& path) override;
+  bool remove(const string& path) override;
+  bool rename(const string& from, const string& to) override;
+
+  uint64_t spaceUsed() override;
+  uint64_t spaceTotal() override;
+
+  struct Node
+  {
+    bool directory = false;
+    bool linked = true; // false once removed, open files keep the node alive
+    uint64_t modified = 0;
+    uint64_t size = 0;
+    vector<unique_ptr<char[]>> chunks;
+    std::map<string, std::shared_ptr<Node>> children;
+  };
+
+  // grows or shrinks a file, new bytes are zero. false when there is no space left
+  bool resize(Node* file, uint64_t size);
+
+private:
+  std::shared_ptr<Node> find(const vector<string>& parts) const;
+  uint64_t release(Node* node); // unlinks a node and its children, returns the bytes they counted
+
+  std::shared_ptr<Node> _root;
+  uint64_t _capacity;
+  uint64_t _used = 0;
+};
@@ -71,6 +71,7 @@ static void segfault_sigaction(int signal, siginfo_t* pSigInfo, void* arg)
 void TtyReader::start(AnsiEscapeTerm* pTerm)
 {
   _pTerm = pTerm;
+  _resolution = current_resolution();
   _kb_drv = KeyboardTerminalDriver::create(hasMasterTty());
 
   if (hasTerminalOut())
@@ -196,6 +197,14 @@ bool TtyReader::runOnce()
     break;
   }
 
+  // the vm sleeps while idle, it learns of a resize from us rather than by polling
+  auto rez = current_resolution();
+  if (rez != _resolution && _pTerm)
+  {
+    _resolution = rez;
+    _pTerm->resized();
+  }
+
   auto old_size = _buffer.size();
   if (old_size > 0)
   {
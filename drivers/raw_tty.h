@@ -6,6 +6,8 @@
 #include "worker.h"
 
 #include <memory>
+#include <tuple>
+using std::tuple;
 using std::unique_ptr;
 
 struct termios;
@@ -36,4 +38,5 @@ private:
   unique_ptr<KeyboardTerminalDriver> _kb_drv;
 
   AnsiEscapeTerm* _pTerm = nullptr;
+  tuple<int, int> _resolution; // last seen, a change is passed on to the term
 };
@@ -0,0 +1,70 @@
+#include "stat_cache.h"
+#include "drivers/fs_utils.h"
+
+// past this many entries the cache starts over, it is only ever a shortcut
+static const size_t max_entries = 16384;
+
+using lock_t = std::unique_lock<std::mutex>;
+
+bool StatCache::stat(const string& path, Stat* out) const
+{
+  lock_t lk(_m);
+  auto it = _stats.find(fs_utils::trim(path));
+  if (it == _stats.end())
+    return false;
+  *out = it->second;
+  return true;
+}
+
+void StatCache::stat(const string& path, const Stat& value)
+{
+  lock_t lk(_m);
+  if (_stats.size() >= max_entries)
+    _stats.clear();
+  _stats[fs_utils::trim(path)] = value;
+}
+
+bool StatCache::list(const string& path, vector<string>* out) const
+{
+  lock_t lk(_m);
+  auto it = _lists.find(fs_utils::trim(path));
+  if (it == _lists.end())
+    return false;
+  *out = it->second;
+  return true;
+}
+
+void StatCache::list(const string& path, const vector<string>& names)
+{
+  lock_t lk(_m);
+  if (_lists.size() >= max_entries)
+    _lists.clear();
+  _lists[fs_utils::trim(path)] = names;
+}
+
+template <typename T>
+void StatCache::erase(map<string, T>* entries, const string& path)
+{
+  entries->erase(path);
+  fs_utils::erase_under(*entries, path);
+
+  // the parents' listings and times change with their children, and a parent may have just been made
+  for (size_t slash = path.find_last_of('/'); slash != string::npos && slash > 0; slash = path.find_last_of('/', slash - 1))
+    entries->erase(path.substr(0, slash));
+  entries->erase("/");
+}
+
+void StatCache::invalidate(const string& path)
+{
+  string key = fs_utils::trim(path);
+  lock_t lk(_m);
+  erase(&_stats, key);
+  erase(&_lists, key);
+}
+
+void StatCache::clear()
+{
+  lock_t lk(_m);
+  _stats.clear();
+  _lists.clear();
+}
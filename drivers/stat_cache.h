@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using std::map;
+using std::string;
+using std::vector;
+
+// Remembered metadata of host paths, so repeated lookups don't go back to the host
+// Paths that don't exist are remembered too, path resolution probes many of them.
+// The owner invalidates what it changes, the cache never checks the host by itself.
+// Lookups lock, a read only filesystem may be shared by vms on several threads.
+class StatCache
+{
+public:
+  struct Stat
+  {
+    bool exists = false;
+    bool directory = false;
+    uint64_t size = 0;
+    uint64_t modified = 0; // unix time
+  };
+
+  // false when the path is not cached
+  bool stat(const string& path, Stat* out) const;
+  void stat(const string& path, const Stat& value);
+  // names as listed by the filesystem, directories end with a slash
+  bool list(const string& path, vector<string>* out) const;
+  void list(const string& path, const vector<string>& names);
+
+  // forgets path, everything under it and the directories above it
+  void invalidate(const string& path);
+  void clear();
+
+private:
+  template <typename T>
+  static void erase(map<string, T>* entries, const string& path);
+
+  mutable std::mutex _m;
+  map<string, Stat> _stats; // ordered, a directory is a range of paths
+  map<string, vector<string>> _lists;
+};
@@ -26,7 +26,8 @@ bool Worker::start()
 
   _running = true;
   _continue = true;
-  _pthread = new thread(&Worker::proc, this);
+  // the worker logs to the vm that started it
+  _pthread = new thread(&Worker::proc, this, Logger::context());
 
   return true;
 }
@@ -47,8 +48,9 @@ void Worker::stop()
   _pthread = nullptr;
 }
 
-void Worker::proc()
+void Worker::proc(LoggerContext ctx)
 {
+  Logger::context(ctx);
   {
     auto lock = make_lock();
     _continue = _continue && onStart();
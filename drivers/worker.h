@@ -1,5 +1,7 @@
 #pragma once
 
+#include "model/log.h"
+
 #include <mutex>
 #include <thread>
 #include <atomic>
@@ -34,7 +36,7 @@ protected:
   unique_lock<mutex> make_lock();
 
 private:
-  void proc();
+  void proc(LoggerContext ctx);
   volatile bool _continue = false;
   thread* _pthread = nullptr;
   bool _running = false;
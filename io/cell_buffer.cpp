@@ -0,0 +1,55 @@
+#include "cell_buffer.h"
+
+#include <algorithm>
+#include <cstring>
+
+void CellBuffer::resize(int width, int height)
+{
+  width = std::max(0, width);
+  height = std::max(0, height);
+  if (width == 0 || height == 0)
+    width = height = 0;
+
+  size_t size = static_cast<size_t>(width) * height;
+  vector<uint32_t> codepoints(size, ' ');
+  vector<uint32_t> colors(size, 0);
+  vector<uint8_t> flags(size, packFlags(1, false));
+
+  int keep_width = std::min(width, _width);
+  int keep_height = std::min(height, _height);
+  for (int y = 0; y < keep_height; y++)
+  {
+    size_t from = static_cast<size_t>(y) * _width;
+    size_t to = static_cast<size_t>(y) * width;
+    std::memcpy(codepoints.data() + to, _codepoints.data() + from, keep_width * sizeof(uint32_t));
+    std::memcpy(colors.data() + to, _colors.data() + from, keep_width * sizeof(uint32_t));
+    std::memcpy(flags.data() + to, _flags.data() + from, keep_width * sizeof(uint8_t));
+  }
+
+  _codepoints.swap(codepoints);
+  _colors.swap(colors);
+  _flags.swap(flags);
+  _width = width;
+  _height = height;
+}
+
+void CellBuffer::fill(size_t i, size_t count, uint32_t codepoint, uint32_t colors, uint8_t flags)
+{
+  std::fill_n(_codepoints.data() + i, count, codepoint);
+  std::fill_n(_colors.data() + i, count, colors);
+  std::memset(_flags.data() + i, flags, count);
+}
+
+void CellBuffer::move(size_t dst, size_t src, size_t count)
+{
+  std::memmove(_codepoints.data() + dst, _codepoints.data() + src, count * sizeof(uint32_t));
+  std::memmove(_colors.data() + dst, _colors.data() + src, count * sizeof(uint32_t));
+  std::memmove(_flags.data() + dst, _flags.data() + src, count * sizeof(uint8_t));
+}
+
+void CellBuffer::copy(size_t dst, const CellBuffer& src, size_t from, size_t count)
+{
+  std::memcpy(_codepoints.data() + dst, src._codepoints.data() + from, count * sizeof(uint32_t));
+  std::memcpy(_colors.data() + dst, src._colors.data() + from, count * sizeof(uint32_t));
+  std::memcpy(_flags.data() + dst, src._flags.data() + from, count * sizeof(uint8_t));
+}
@@ -0,0 +1,140 @@
+#pragma once
+
+#include "color/color_types.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+using std::vector;
+
+// Screen contents stored as parallel arrays, one entry per cell, row major
+// Each cell is 9 bytes: the glyph as a unicode codepoint, the fg and bg colors packed
+// into one word, and a flags byte holding the glyph width and the lock bit.
+// A 160x50 screen is about 70KB, and rows are contiguous in every array so
+// moving or filling a span of cells is a memmove or a pattern store per array.
+class CellBuffer
+{
+public:
+  // a packed color is a deflated color value (0-255) and the paletted bit
+  static const uint16_t PalettedBit = 0x100;
+  static const uint8_t WidthMask = 0x03;
+  static const uint8_t LockedBit = 0x04;
+
+  static inline uint16_t packColor(const Color& color)
+  {
+    return static_cast<uint16_t>((color.rgb & 0xFF) | (color.paletted ? PalettedBit : 0));
+  }
+
+  static inline uint32_t packColors(const Color& fg, const Color& bg)
+  {
+    return packColor(fg) | (static_cast<uint32_t>(packColor(bg)) << 16);
+  }
+
+  static inline uint8_t packFlags(int width, bool locked)
+  {
+    return static_cast<uint8_t>((width & WidthMask) | (locked ? LockedBit : 0));
+  }
+
+  // keeps the cells that overlap the old size, new cells are blank
+  void resize(int width, int height);
+
+  int width() const
+  {
+    return _width;
+  }
+
+  int height() const
+  {
+    return _height;
+  }
+
+  // positions are 1-based
+  bool contains(int x, int y) const
+  {
+    return x >= 1 && x <= _width && y >= 1 && y <= _height;
+  }
+
+  size_t index(int x, int y) const
+  {
+    return static_cast<size_t>(y - 1) * _width + (x - 1);
+  }
+
+  size_t size() const
+  {
+    return _codepoints.size();
+  }
+
+  uint32_t codepoint(size_t i) const
+  {
+    return _codepoints[i];
+  }
+
+  uint32_t colors(size_t i) const
+  {
+    return _colors[i];
+  }
+
+  uint16_t fg(size_t i) const
+  {
+    return _colors[i] & 0xFFFF;
+  }
+
+  uint16_t bg(size_t i) const
+  {
+    return _colors[i] >> 16;
+  }
+
+  uint8_t flags(size_t i) const
+  {
+    return _flags[i];
+  }
+
+  int cellWidth(size_t i) const
+  {
+    return _flags[i] & WidthMask;
+  }
+
+  bool locked(size_t i) const
+  {
+    return (_flags[i] & LockedBit) != 0;
+  }
+
+  void unlock(size_t i)
+  {
+    _flags[i] &= ~LockedBit;
+  }
+
+  void set(size_t i, uint32_t codepoint, uint32_t colors, uint8_t flags)
+  {
+    _codepoints[i] = codepoint;
+    _colors[i] = colors;
+    _flags[i] = flags;
+  }
+
+  // stores the same cell in count cells starting at i
+  void fill(size_t i, size_t count, uint32_t codepoint, uint32_t colors, uint8_t flags);
+
+  // copies count cells from src to dst, the ranges may overlap
+  void move(size_t dst, size_t src, size_t count);
+
+  // copies count cells starting at from in another buffer to dst
+  void copy(size_t dst, const CellBuffer& src, size_t from, size_t count);
+
+  // replaces every packed color c with remap(c)
+  template <typename Fn>
+  void recolor(Fn remap)
+  {
+    for (auto& colors : _colors)
+    {
+      colors = remap(colors & 0xFFFF) | (static_cast<uint32_t>(remap(colors >> 16)) << 16);
+    }
+  }
+
+private:
+  int _width = 0;
+  int _height = 0;
+
+  vector<uint32_t> _codepoints;
+  vector<uint32_t> _colors;
+  vector<uint8_t> _flags;
+};
@@ -1,15 +1,18 @@
 #pragma once
 
+#include <chrono>
+#include <condition_variable>
+#include <functional>
 #include <memory>
 #include <mutex>
-#include <queue>
 #include <vector>
+using std::condition_variable;
 using std::mutex;
-using std::queue;
 using std::string;
 using std::unique_lock;
 using std::vector;
 
+#include "io/mpsc_queue.h"
 #include "model/value.h"
 
 enum class EPressType
@@ -48,27 +51,83 @@ struct ModemEvent
   vector<char> payload;
 };
 
-template <typename TEvent>
-class EventSource
+// Wakes a thread blocked in wait_for when any event source pushes
+// A notify that arrives before the wait is not lost, the next wait returns immediately
+class EventNotifier
 {
 public:
-  bool pop(TEvent& te)
+  void notify()
+  {
+    {
+      unique_lock<mutex> lk(_m);
+      _pending = true;
+    }
+    _cv.notify_all();
+    if (_forward)
+      _forward();
+  }
+
+  // fn is additionally called on every notify, e.g. to reschedule a vm that isn't waiting on this notifier
+  // set it before any event source can push
+  void forward(std::function<void()> fn)
+  {
+    _forward = fn;
+  }
+
+  // blocks until notified
+  void wait()
   {
     unique_lock<mutex> lk(_m);
-    if (_events.size() == 0)
-      return false; // empty
-    te = _events.front();
-    _events.pop();
-    return true;
+    _cv.wait(lk, [this] { return _pending; });
+    _pending = false;
   }
 
-  void push(const TEvent& te)
+  // returns true if notified, false if the timeout expired first
+  bool wait_for(double seconds)
   {
     unique_lock<mutex> lk(_m);
-    _events.push(te);
+    if (seconds > 0)
+    {
+      _cv.wait_for(lk, std::chrono::duration<double>(seconds), [this] { return _pending; });
+    }
+    bool notified = _pending;
+    _pending = false;
+    return notified;
   }
 
 private:
   mutex _m;
-  queue<TEvent> _events;
+  condition_variable _cv;
+  bool _pending = false;
+  std::function<void()> _forward;
+};
+
+template <typename TEvent>
+class EventSource
+{
+public:
+  // the notifier is signaled on every push, e.g. to wake the vm from standby
+  void notifier(EventNotifier* pNotifier)
+  {
+    _notifier = pNotifier;
+  }
+
+  bool pop(TEvent& te)
+  {
+    return _events.pop(te);
+  }
+
+  // returns false if the event was dropped because the vm fell too far behind
+  bool push(const TEvent& te)
+  {
+    // driver threads wait briefly for the vm to catch up before giving up on the event
+    bool pushed = _events.push_wait(te, std::chrono::milliseconds(100));
+    if (_notifier)
+      _notifier->notify();
+    return pushed;
+  }
+
+private:
+  MpscQueue<TEvent> _events;
+  EventNotifier* _notifier = nullptr;
 };
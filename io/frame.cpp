@@ -1,6 +1,11 @@
 #include "frame.h"
 #include "color/color_types.h"
 
+#include <algorithm>
+using std::chrono::duration;
+using std::chrono::duration_cast;
+using std::chrono::steady_clock;
+
 Frame::~Frame()
 {
   _screen = nullptr;
@@ -21,6 +26,31 @@ bool Frame::update()
     return false;
 
   onUpdate();
+
+  bool fresh = _fresh;
+  _fresh = false;
+  if (_discarded)
+  {
+    _discarded = false;
+    _stats.dropped++;
+  }
+
+  if (_pending)
+  {
+    auto now = steady_clock::now();
+    if (now >= _next_present)
+    {
+      _pending = false;
+      _next_present = now + _interval;
+      onPresent();
+      _stats.presented++;
+    }
+    else if (fresh)
+    {
+      _stats.merged++;
+    }
+  }
+
   return true;
 }
 
@@ -32,9 +62,43 @@ void Frame::close()
 
 void Frame::write(int x, int y, const Cell& cell, ColorState& _cst)
 {
-  if (cell.locked || !on())
+  if (cell.locked)
     return;
+  if (!on())
+  {
+    _discarded = true;
+    return;
+  }
   onWrite(x, y, cell, _cst);
+
+  _fresh = true;
+  if (!_pending)
+  {
+    _pending = true;
+    if (_screen)
+      _screen->damaged();
+  }
+}
+
+void Frame::maxFps(double fps)
+{
+  if (fps > 0)
+    _interval = duration_cast<steady_clock::duration>(duration<double>(1.0 / fps));
+  else
+    _interval = steady_clock::duration::zero();
+}
+
+double Frame::presentDelay() const
+{
+  if (!_pending)
+    return -1;
+  auto delay = duration_cast<duration<double>>(_next_present - steady_clock::now()).count();
+  return std::max(0.0, delay);
+}
+
+const FrameStats& Frame::stats() const
+{
+  return _stats;
 }
 
 tuple<int, int> Frame::size() const
@@ -67,6 +131,12 @@ void Frame::keyEvent(const KeyEvent& ke)
     _screen->push(ke);
 }
 
+void Frame::wake()
+{
+  if (_screen)
+    _screen->wake();
+}
+
 bool Frame::on() const
 {
   return _isOn;
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstdint>
+#include <chrono>
 #include <iostream>
 #include <memory>
 #include <string>
@@ -14,9 +16,16 @@ using std::vector;
 #include "color/color_types.h"
 #include "io/event.h"
 
+struct FrameStats
+{
+  uint64_t presented = 0; // frames drawn
+  uint64_t merged = 0;    // updates with new writes held back by the fps cap, drawn with a later frame
+  uint64_t dropped = 0;   // updates whose writes were discarded because the screen was off
+};
+
 struct Cell
 {
-  string value; // must be a string for multibyte chars
+  uint32_t codepoint; // see UnicodeApi::toutf8
   Color fg;
   Color bg;
   bool locked; // locked when a double wide is placed before it
@@ -30,6 +39,9 @@ public:
   virtual void push(const MouseEvent& me) = 0;
   virtual void push(const KeyEvent& me) = 0;
   virtual void invalidate() = 0;
+  virtual void damaged() = 0;
+  // safe from any thread
+  virtual void wake() = 0;
 };
 
 class Frame
@@ -59,6 +71,10 @@ public:
   // see io/event.h for KeyEvent details
   void keyEvent(const KeyEvent& ke);
 
+  // Call wake, from any thread, when update should run soon for a change the vm can't see
+  // e.g. the window was resized, an idle vm otherwise sleeps until it has something to do
+  void wake();
+
   // it is optional to override depth
   virtual EDepthType depth()
   {
@@ -75,6 +91,11 @@ protected:
   virtual void onUpdate()
   {
   }
+  // called after onUpdate when there were writes since the last present, at most max fps times per second
+  // frames that buffer onWrite output draw it here, all writes between presents are coalesced
+  virtual void onPresent()
+  {
+  }
   virtual void onClose()
   {
   }
@@ -104,12 +125,25 @@ public:
   bool on() const;
   bool on(bool bOn);
 
+  // caps how often onPresent is called, 0 presents on every update
+  void maxFps(double fps);
+  // seconds until pending writes can be presented, negative when nothing is pending
+  double presentDelay() const;
+  const FrameStats& stats() const;
+
 private:
   IScreen* _screen = nullptr;
 
   int _width;
   int _height;
   bool _isOn;
+
+  std::chrono::steady_clock::duration _interval{};
+  std::chrono::steady_clock::time_point _next_present{};
+  bool _pending = false;   // written since the last present
+  bool _fresh = false;     // written since the last update
+  bool _discarded = false; // writes dropped since the last update
+  FrameStats _stats;
 };
 
 namespace Factory
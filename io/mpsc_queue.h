@@ -0,0 +1,154 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <utility>
+using std::atomic;
+using std::condition_variable;
+using std::mutex;
+using std::unique_lock;
+
+// Bounded lock-free multi-producer/single-consumer ring (Vyukov's bounded queue)
+// Any thread may push, only one thread (the vm thread) may pop
+// Each cell carries a sequence number; producers claim a slot by advancing the tail
+// and publish it by bumping the cell sequence, so producers never take a lock
+template <typename T, size_t Capacity = 256>
+class MpscQueue
+{
+  static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "MpscQueue capacity must be a power of two");
+
+public:
+  MpscQueue()
+  {
+    for (size_t i = 0; i < Capacity; i++)
+      _cells[i].seq.store(i, std::memory_order_relaxed);
+  }
+
+  MpscQueue(const MpscQueue&) = delete;
+  MpscQueue& operator=(const MpscQueue&) = delete;
+
+  static constexpr size_t capacity()
+  {
+    return Capacity;
+  }
+
+  // returns false if the queue is full, the value is only consumed on success
+  template <typename U>
+  bool try_push(U&& value)
+  {
+    Cell* cell;
+    size_t pos = _tail.load(std::memory_order_relaxed);
+    for (;;)
+    {
+      cell = &_cells[pos & (Capacity - 1)];
+      size_t seq = cell->seq.load(std::memory_order_acquire);
+      auto diff = static_cast<std::ptrdiff_t>(seq - pos);
+      if (diff == 0)
+      {
+        if (_tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+          break;
+      }
+      else if (diff < 0)
+      {
+        return false; // full
+      }
+      else
+      {
+        pos = _tail.load(std::memory_order_relaxed);
+      }
+    }
+
+    cell->data = std::forward<U>(value);
+    cell->seq.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  // blocking fallback for producers that must not drop: waits for the consumer to make room
+  // returns false if the queue is still full after the timeout
+  template <typename U>
+  bool push_wait(U&& value, std::chrono::milliseconds timeout)
+  {
+    if (try_push(std::forward<U>(value)))
+      return true;
+
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    unique_lock<mutex> lk(_space_m);
+    _waiters.fetch_add(1);
+    bool pushed = false;
+    while (!(pushed = try_push(std::forward<U>(value))))
+    {
+      if (std::chrono::steady_clock::now() >= deadline)
+        break;
+      // short slices, a pop racing our registration above can't stall us for long
+      _space_cv.wait_for(lk, std::chrono::milliseconds(1));
+    }
+    _waiters.fetch_sub(1);
+    return pushed;
+  }
+
+  // consumer only
+  bool pop(T& value)
+  {
+    Cell& cell = _cells[_head & (Capacity - 1)];
+    size_t seq = cell.seq.load(std::memory_order_acquire);
+    if (static_cast<std::ptrdiff_t>(seq - (_head + 1)) < 0)
+      return false; // empty, or the next producer hasn't published yet
+
+    value = std::move(cell.data);
+    cell.seq.store(_head + Capacity, std::memory_order_release);
+    _head++;
+
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (_waiters.load(std::memory_order_relaxed) > 0)
+    {
+      unique_lock<mutex> lk(_space_m);
+      _space_cv.notify_all();
+    }
+    return true;
+  }
+
+  // consumer only, pops everything published so far
+  template <typename Fn>
+  size_t drain(Fn fn)
+  {
+    size_t count = 0;
+    T value;
+    while (pop(value))
+    {
+      fn(value);
+      count++;
+    }
+    return count;
+  }
+
+  // consumer only
+  bool empty() const
+  {
+    const Cell& cell = _cells[_head & (Capacity - 1)];
+    return static_cast<std::ptrdiff_t>(cell.seq.load(std::memory_order_acquire) - (_head + 1)) < 0;
+  }
+
+  // consumer only, approximate while producers are active
+  size_t size() const
+  {
+    return _tail.load(std::memory_order_acquire) - _head;
+  }
+
+private:
+  struct Cell
+  {
+    atomic<size_t> seq;
+    T data;
+  };
+
+  alignas(64) Cell _cells[Capacity];
+  alignas(64) atomic<size_t> _tail { 0 };
+  alignas(64) size_t _head = 0;
+
+  mutex _space_m;
+  condition_variable _space_cv;
+  atomic<int> _waiters { 0 };
+};
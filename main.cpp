@@ -4,22 +4,32 @@
 #include "model/client.h"
 #include "model/host.h"
 #include "model/log.h"
+#include "model/machine_pool.h"
+#include "model/prof_log.h"
 #include <memory>
 #include <string>
+#include <thread>
 
 using std::cerr;
 
 void usage()
 {
-  cerr << "ocvm [ENV_PATH] [OPTIONS]\n"
+  cerr << "ocvm [ENV_PATH...] [OPTIONS]\n"
           "   ENV_PATH            (optional) VM env path. Default ./tmp\n"
+          "                       Given more than one, the vms run headless in this process\n"
           "OPTIONS\n"
-          "  --frame=TYPE         Term emulator type. Can be 'ansi' (default) or 'basic'.\n"
-          "  --log-allocs[=PATH]  Enable logging mallocs and stacks.\n"
+          "  --frame=TYPE         Term emulator type. Can be 'ansi' (default), 'basic' or 'headless'.\n"
+          "  --log-allocs[=PATH]  Enable sampling mallocs and stacks to a binary profile.\n"
           "                       Optional custom path, default stack.log\n"
+          "                       Read it with tools/prof_report\n"
+          "  --alloc-sample=BYTES Sample one alloc per BYTES allocated. Default 8192\n"
           "  --bios=PATH          Path to custom eeprom bios code\n"
           "  --machine=PATH       Path to custom machine.lua\n"
-          "  --fonts=PATH         Path to custom fonts.hex\n";
+          "  --fonts=PATH         Path to custom fonts.hex\n"
+          "  --threads=N          Threads shared by the vms when running more than one.\n"
+          "                       Default is the number of cpu cores\n"
+          "  --fast-reboot[=BOOL] Keep the components alive across reboots, only the lua\n"
+          "                       state is recreated. Default false\n";
   ::exit(1);
 }
 
@@ -34,15 +44,21 @@ struct Args
     FrameKey,
     BiosKey,
     MachineKey,
-    FontsKey
+    FontsKey,
+    ThreadsKey,
+    AllocSampleKey,
+    FastRebootKey
   };
 
-  const string keys[FontsKey + 1] = {
+  const string keys[FastRebootKey + 1] = {
     "log-allocs",
     "frame",
     "bios",
     "machine",
-    "fonts"
+    "fonts",
+    "threads",
+    "alloc-sample",
+    "fast-reboot"
   };
 
   string get(int n) const
@@ -80,6 +96,8 @@ struct Args
   {
     if (key == keys[LogAllocKey])
       return "stack.log";
+    if (key == keys[FastRebootKey])
+      return "true";
     return "";
   }
 
@@ -89,10 +107,27 @@ struct Args
     return value.empty() ? "tmp" : value;
   }
 
+  vector<string> client_env_paths() const
+  {
+    if (indexed.empty())
+      return { client_env_path() };
+    return indexed;
+  }
+
   string frame_type() const
   {
     string value = get(keys[Args::FrameKey]);
-    return value.empty() ? "ansi" : value;
+    if (value.empty())
+      return indexed.size() > 1 ? "headless" : "ansi";
+    return value;
+  }
+
+  size_t threads() const
+  {
+    string value = get(keys[Args::ThreadsKey]);
+    if (!value.empty())
+      return std::max(atoi(value.c_str()), 1);
+    return std::max(std::thread::hardware_concurrency(), 1u);
   }
 
   string stack_log() const
@@ -100,6 +135,18 @@ struct Args
     return get(keys[Args::LogAllocKey]);
   }
 
+  size_t alloc_sample() const
+  {
+    string value = get(keys[Args::AllocSampleKey]);
+    return value.empty() ? ProfLog::default_sample_bytes : std::max(atoi(value.c_str()), 1);
+  }
+
+  bool fast_reboot() const
+  {
+    string value = get(keys[Args::FastRebootKey]);
+    return value == "true" || value == "1";
+  }
+
   string bios_path() const
   {
     string value = get(keys[Args::BiosKey]);
@@ -119,16 +166,6 @@ struct Args
   }
 };
 
-bool valid_arg_index(size_t size)
-{
-  static size_t expected = 1;
-  if (size > expected)
-  {
-    cerr << "too many arguments, expected " << expected << endl;
-  }
-  return size <= 1;
-}
-
 Args load_args(int argc, char** argv)
 {
   Args args;
@@ -169,16 +206,23 @@ Args load_args(int argc, char** argv)
     else
     {
       args.indexed.push_back(t);
-      if (!valid_arg_index(args.indexed.size()))
-      {
-        usage();
-      }
     }
   }
+
+  if (args.indexed.size() > 1 && args.frame_type() != "headless")
+  {
+    cerr << "only one vm can use the terminal, use --frame=headless to run several vms\n";
+    usage();
+  }
+  if (!args.get(args.keys[Args::ThreadsKey]).empty() && atoi(args.get(args.keys[Args::ThreadsKey]).c_str()) < 1)
+  {
+    cerr << "bad thread count\n";
+    usage();
+  }
   return args;
 }
 
-void prepareMachineDirectory(string path)
+string prepareMachineDirectory(string path)
 {
   string client_env_path = fs_utils::make_pwd_path(path);
   // make the env path if it doesn't already exist
@@ -189,6 +233,7 @@ void prepareMachineDirectory(string path)
   }
 
   Logger::context({ client_env_path });
+  return client_env_path;
 }
 
 string runVirtualMachine(const Args& args)
@@ -201,9 +246,11 @@ string runVirtualMachine(const Args& args)
   // // prepares component factories such as screen, keyboard, and filesystem
   Host host(args.frame_type());
   host.stackLog(args.stack_log());
+  host.allocSample(args.alloc_sample());
   host.biosPath(args.bios_path());
   host.machinePath(args.machine_path());
   host.fontsPath(args.fonts_path());
+  host.fastReboot(args.fast_reboot());
 
   RunState run;
 
@@ -219,6 +266,8 @@ string runVirtualMachine(const Args& args)
     do
     {
       run = client.run();
+      if (run == RunState::Reboot && host.fastReboot() && client.reboot())
+        run = RunState::Continue;
     } while (run == RunState::Continue);
 
     clientShutdownMessage = client.getAllCrashText();
@@ -227,11 +276,39 @@ string runVirtualMachine(const Args& args)
   return clientShutdownMessage;
 }
 
+string runVirtualMachines(const Args& args)
+{
+  Host host(args.frame_type());
+  host.stackLog(args.stack_log());
+  host.allocSample(args.alloc_sample());
+  host.biosPath(args.bios_path());
+  host.machinePath(args.machine_path());
+  host.fontsPath(args.fonts_path());
+  host.fastReboot(args.fast_reboot());
+
+  MachinePool pool(&host, args.threads());
+  vector<string> env_paths = args.client_env_paths();
+  for (const auto& path : env_paths)
+  {
+    pool.add(prepareMachineDirectory(path));
+  }
+
+  stringstream shutdownMessages;
+  vector<string> reports = pool.run();
+  for (size_t i = 0; i < reports.size(); i++)
+  {
+    if (!reports.at(i).empty())
+      shutdownMessages << env_paths.at(i) << ": " << reports.at(i) << "\n";
+  }
+
+  return shutdownMessages.str();
+}
+
 int main(int argc, char** argv)
 {
   auto args = load_args(argc, argv);
 
-  string result = runVirtualMachine(args);
+  string result = args.client_env_paths().size() > 1 ? runVirtualMachines(args) : runVirtualMachine(args);
   std::cout << result;
 
   return !result.empty();
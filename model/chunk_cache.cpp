@@ -0,0 +1,227 @@
+#include "chunk_cache.h"
+#include "drivers/fs_utils.h"
+#include "util/crc32.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+
+// the cache is shared by every vm of the env, and chunk names are up to the machine
+static const size_t max_entries = 1024;
+static const uint64_t max_bytes = 32 * 1024 * 1024;
+
+static const char magic[8] = { 'o', 'c', 'v', 'm', 'l', 'u', 'a', 'c' };
+
+// magic, lua version, key size, mtime, source size, source crc, bytecode crc, then the key and the bytecode
+struct ChunkHeader
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t key_size;
+  uint64_t mtime;
+  uint64_t source_size;
+  uint32_t source_crc;
+  uint32_t bytecode_crc;
+};
+
+static int dump_writer(lua_State* lua, const void* p, size_t size, void* pvOut)
+{
+  static_cast<string*>(pvOut)->append(static_cast<const char*>(p), size);
+  return 0;
+}
+
+ChunkCache::ChunkCache(const string& dir)
+    : _dir(dir)
+{
+  _ready = !_dir.empty() && fs_utils::mkdir(_dir);
+  if (_ready)
+    prune();
+}
+
+size_t ChunkCache::hits() const
+{
+  return _hits;
+}
+
+size_t ChunkCache::misses() const
+{
+  return _misses;
+}
+
+string ChunkCache::pathFor(const string& key) const
+{
+  std::stringstream ss;
+  ss << _dir << "/" << std::hex << std::setw(8) << std::setfill('0') << util::crc32(key) << ".luac";
+  return ss.str();
+}
+
+bool ChunkCache::read(const string& key, string_view source, uint64_t mtime, string* pBytecode) const
+{
+  string data;
+  if (!fs_utils::read(pathFor(key), &data) || data.size() < sizeof(ChunkHeader))
+    return false;
+
+  ChunkHeader header;
+  std::memcpy(&header, data.data(), sizeof(header));
+  if (std::memcmp(header.magic, magic, sizeof(magic)) != 0 ||
+    header.version != LUA_VERSION_NUM ||
+    header.mtime != mtime ||
+    header.source_size != source.size() ||
+    header.key_size != key.size() ||
+    data.size() < sizeof(header) + key.size())
+  {
+    return false;
+  }
+
+  // crc32 names the file, so different keys can share one
+  if (data.compare(sizeof(header), key.size(), key) != 0)
+    return false;
+
+  string_view bytecode(data.data() + sizeof(header) + key.size(), data.size() - sizeof(header) - key.size());
+  if (header.bytecode_crc != util::crc32(bytecode) || header.source_crc != util::crc32(source))
+    return false;
+
+  pBytecode->assign(bytecode.data(), bytecode.size());
+  return true;
+}
+
+void ChunkCache::write(const string& key, string_view source, uint64_t mtime, const string& bytecode)
+{
+  ChunkHeader header;
+  std::memcpy(header.magic, magic, sizeof(magic));
+  header.version = LUA_VERSION_NUM;
+  header.key_size = key.size();
+  header.mtime = mtime;
+  header.source_size = source.size();
+  header.source_crc = util::crc32(source);
+  header.bytecode_crc = util::crc32(bytecode);
+
+  string data(reinterpret_cast<const char*>(&header), sizeof(header));
+  data += key;
+  data += bytecode;
+
+  // other vms may be reading the entry, replace it whole
+  string path = pathFor(key);
+  string temp = path + ".tmp";
+  bool replaced = fs_utils::exists(path);
+  if (!fs_utils::write(string_view(data), temp) || !fs_utils::rename(temp, path))
+    return;
+
+  if (!replaced)
+    _entries++;
+  _bytes += data.size();
+  if (_entries > max_entries || _bytes > max_bytes)
+    prune();
+}
+
+void ChunkCache::prune()
+{
+  struct Entry
+  {
+    uint64_t modified;
+    string path;
+    uint64_t size;
+  };
+
+  vector<Entry> entries;
+  _bytes = 0;
+  for (const auto& path : fs_utils::list(_dir))
+  {
+    uint64_t size = fs_utils::size(path);
+    entries.push_back({ fs_utils::lastModified(path), path, size });
+    _bytes += size;
+  }
+  _entries = entries.size();
+  if (_entries <= max_entries && _bytes <= max_bytes)
+    return;
+
+  // down to three quarters, so the next few writes don't prune again
+  std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.modified < b.modified; });
+  for (const auto& entry : entries)
+  {
+    if (_entries <= max_entries / 4 * 3 && _bytes <= max_bytes / 4 * 3)
+      break;
+    if (fs_utils::remove(entry.path))
+    {
+      _entries--;
+      _bytes -= entry.size;
+    }
+  }
+}
+
+int ChunkCache::load(lua_State* lua, const string& key, string_view source, const char* chunkname, const char* mode, uint64_t mtime)
+{
+  string bytecode;
+  if (_ready && read(key, source, mtime, &bytecode))
+  {
+    if (luaL_loadbufferx(lua, bytecode.data(), bytecode.size(), chunkname, "b") == LUA_OK)
+    {
+      _hits++;
+      return LUA_OK;
+    }
+    lua_pop(lua, 1); // a stale chunk, e.g. from another lua build
+  }
+
+  _misses++;
+  int status = luaL_loadbufferx(lua, source.data(), source.size(), chunkname, mode);
+  if (status == LUA_OK && _ready)
+  {
+    // with debug info, error messages and tracebacks are those of the source
+#if LUA_VERSION_NUM > 502
+    lua_dump(lua, dump_writer, &bytecode, 0);
+#else
+    lua_dump(lua, dump_writer, &bytecode);
+#endif
+    write(key, source, mtime, bytecode);
+  }
+
+  return status;
+}
+
+// load(chunk [, chunkname [, mode [, env]]])
+// upvalues: the original load, the cache, the minimum size
+static int cached_load(lua_State* lua)
+{
+  size_t size = 0;
+  const char* source = lua_type(lua, 1) == LUA_TSTRING ? lua_tolstring(lua, 1, &size) : nullptr;
+  const char* chunkname = lua_type(lua, 2) == LUA_TSTRING ? lua_tostring(lua, 2) : nullptr;
+  const char* mode = lua_type(lua, 3) == LUA_TSTRING ? lua_tostring(lua, 3) : "bt";
+  size_t min_size = static_cast<size_t>(lua_tointeger(lua, lua_upvalueindex(3)));
+
+  // binary chunks are left to the original load, which honours the mode
+  if (!source || !chunkname || size < min_size || source[0] == LUA_SIGNATURE[0] || !std::strchr(mode, 't'))
+  {
+    int top = lua_gettop(lua);
+    lua_pushvalue(lua, lua_upvalueindex(1));
+    lua_insert(lua, 1);
+    lua_call(lua, top, LUA_MULTRET);
+    return lua_gettop(lua);
+  }
+
+  auto* pCache = static_cast<ChunkCache*>(lua_touserdata(lua, lua_upvalueindex(2)));
+  if (pCache->load(lua, chunkname, string_view(source, size), chunkname, mode) != LUA_OK)
+  {
+    lua_pushnil(lua);
+    lua_insert(lua, -2);
+    return 2; // nil, message
+  }
+
+  if (!lua_isnone(lua, 4))
+  {
+    lua_pushvalue(lua, 4);
+    if (!lua_setupvalue(lua, -2, 1)) // _ENV
+      lua_pop(lua, 1);
+  }
+
+  return 1;
+}
+
+void ChunkCache::install(lua_State* lua, size_t min_size)
+{
+  lua_getglobal(lua, "load");
+  lua_pushlightuserdata(lua, this);
+  lua_pushinteger(lua, static_cast<lua_Integer>(min_size));
+  lua_pushcclosure(lua, cached_load, 3);
+  lua_setglobal(lua, "load");
+}
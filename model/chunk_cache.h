@@ -0,0 +1,47 @@
+#pragma once
+
+#include "apis/native-lua.h"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+using std::string;
+using std::string_view;
+
+// On disk cache of compiled lua chunks (lua_dump output)
+// An entry is found by its key, e.g. a file path, and is valid while the source has the
+// same modification time, size and crc32 it had when it was compiled. Bytecode is only
+// ever produced here from text sources, so a cached chunk behaves as its source would.
+// The directory is capped in entries and bytes, past either the oldest entries are removed.
+class ChunkCache
+{
+public:
+  explicit ChunkCache(const string& dir);
+
+  // like luaL_loadbufferx for a text chunk: pushes the function or an error message and
+  // returns the load status, a compiled chunk is written to the cache
+  int load(lua_State* lua, const string& key, string_view source, const char* chunkname, const char* mode = "t", uint64_t mtime = 0);
+
+  // replaces the global load with one that serves text chunks of at least min_size bytes
+  // from this cache, other loads (binary chunks, reader functions) go to the original load
+  // the cache must outlive the lua state
+  void install(lua_State* lua, size_t min_size);
+
+  size_t hits() const;
+  size_t misses() const;
+
+private:
+  string pathFor(const string& key) const;
+  bool read(const string& key, string_view source, uint64_t mtime, string* pBytecode) const;
+  void write(const string& key, string_view source, uint64_t mtime, const string& bytecode);
+  // counts the entries on disk, removing the oldest while over the caps
+  void prune();
+
+  string _dir;
+  bool _ready = false;
+  size_t _entries = 0; // on disk, as of the last prune plus what was written since
+  uint64_t _bytes = 0;
+  size_t _hits = 0;
+  size_t _misses = 0;
+};
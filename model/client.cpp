@@ -11,17 +11,35 @@
 #include "apis/unicode.h"
 #include "apis/userdata.h"
 
+#include <algorithm>
+#include <chrono>
+#include <cstring>
 #include <functional>
 #include <iostream>
+#include <limits>
 #include <sstream>
 #include <string>
 
 using Logging::lout;
+using std::chrono::duration;
+using std::chrono::duration_cast;
+using std::chrono::system_clock;
+
+// no component asked to run again, only an event source wakes the client
+static const double no_deadline = std::numeric_limits<double>::max();
+// a far deadline is waited for in parts, the clock can't hold arbitrary durations
+static const double max_wait = 24 * 60 * 60;
+
+inline double now()
+{
+  return duration_cast<duration<double>>(system_clock::now().time_since_epoch()).count();
+}
 
 Client::Client(Host* host, const string& env_path)
     : LuaProxy("component")
     , _computer(nullptr)
     , _config(nullptr)
+    , _system(new SystemApi)
     , _env_path(env_path)
     , _host(host)
 {
@@ -31,6 +49,7 @@ Client::Client(Host* host, const string& env_path)
   add("type", &Client::component_type);
   add("slot", &Client::component_slot);
   add("doc", &Client::component_doc);
+  clearInvokeCache();
 }
 
 Client::~Client()
@@ -107,6 +126,7 @@ bool Client::createComponents()
         }
         else
         {
+          indexComponent(pc.get());
           _components.push_back(std::move(pc));
           lout << "ready\n";
         }
@@ -114,7 +134,7 @@ bool Client::createComponents()
     }
     else if (section == "system")
     {
-      SystemApi::configure(section_data);
+      _system->configure(section_data);
     }
   }
   return true;
@@ -131,7 +151,7 @@ bool Client::postInit()
       return false;
     }
     // the vm boot handles component_added for us
-    // _computer->pushSignal(ValuePack({"component_added", pc->address(), pc->type()}));
+    // _computer->pushSignal({"component_added", pc->address(), pc->type()});
   }
 
   return true;
@@ -146,15 +166,53 @@ bool Client::loadLuaComponentApi()
     return false;
   }
 
-  _computer->stackLog(_host->stackLog());
+  _computer->stackLog(_host->stackLog(), _host->allocSample());
   _computer->newlib(this);
   _computer->newlib(OSApi::get());
-  _computer->newlib(SystemApi::get());
+  _computer->newlib(_system.get());
   _computer->newlib(UnicodeApi::get());
   _computer->newlib(UserDataApi::get());
   return true;
 }
 
+bool Client::reboot()
+{
+  if (!_config || !_computer)
+    return false;
+
+  _config->save();
+
+  // the computer goes first, finalizers of its lua state still reach the other components
+  if (!_computer->onReboot())
+  {
+    lout << "computer failed to reboot\n";
+    return false;
+  }
+
+  for (auto* pc : components())
+  {
+    if (pc != _computer && !pc->onReboot())
+    {
+      lout << pc->type() << "[" << pc->address() << "] failed to reboot\n";
+      return false;
+    }
+  }
+
+  clearInvokeCache();
+  _crash.clear();
+  _wake = 0;
+
+  if (!loadLuaComponentApi())
+    return false;
+
+  // the other components are still attached to each other, only the machine is loaded again
+  if (!_computer->postInit())
+    return false;
+
+  lout << "client rebooted\n";
+  return true;
+}
+
 void Client::close()
 {
   if (_config)
@@ -170,6 +228,8 @@ void Client::close()
   for (auto& pc : _components)
     comp_copy.push_back(std::move(pc));
   _components.clear();
+  _addresses.clear();
+  clearInvokeCache();
 
   // now the screen should be closed, we can report crash info
   std::cerr << _crash;
@@ -196,14 +256,27 @@ vector<Component*> Client::components(string filter, bool exact) const
 
 Component* Client::component(const string& address) const
 {
-  for (auto& pc : _components)
-  {
-    if (pc->address() == address)
-    {
-      return pc.get();
-    }
-  }
-  return nullptr;
+  const auto& it = _addresses.find(address);
+  if (it == _addresses.end())
+    return nullptr;
+  return it->second;
+}
+
+void Client::indexComponent(Component* pc)
+{
+  // the first component with an address wins, as the linear scan used to
+  _addresses.emplace(pc->address(), pc);
+}
+
+void Client::clearInvokeCache()
+{
+  for (auto& entry : _invoke_cache)
+    entry = { nullptr, nullptr, nullptr, nullptr };
+}
+
+static inline bool same_text(const string& text, const char* cstr, size_t len)
+{
+  return text.size() == len && std::memcmp(text.data(), cstr, len) == 0;
 }
 
 int Client::component_list(lua_State* lua)
@@ -230,17 +303,48 @@ int Client::component_invoke(lua_State* lua)
   // for logging, this is called via LuaProxy because all method calls are dispatched there first
   // LuaProxy::invoke has already logged much about this call, but is waiting to log the result
 
+  if (lua_type(lua, 1) != LUA_TSTRING || lua_type(lua, 2) != LUA_TSTRING)
+  {
+    // raises the usual bad argument errors
+    Value::checkArg<string>(lua, 1);
+    lua_remove(lua, 1);
+    Value::checkArg<string>(lua, 1);
+  }
+
+  size_t address_len;
+  size_t method_len;
+  const char* address = lua_tolstring(lua, 1, &address_len);
+  const char* method = lua_tolstring(lua, 2, &method_len);
+
+  // lua strings this short are interned, repeated invokes pass the same pointers
+  size_t slot = ((reinterpret_cast<uintptr_t>(address) ^ reinterpret_cast<uintptr_t>(method)) >> 4) & (invoke_cache_size - 1);
+  InvokeCacheEntry& entry = _invoke_cache[slot];
+  if (entry.address != address || entry.method != method ||
+    !same_text(entry.component->address(), address, address_len) ||
+    !same_text(entry.pmethod->first, method, method_len))
+  {
+    string addressText(address, address_len);
+    Component* pc = component(addressText);
+    if (!pc)
+      return ValuePack::ret(lua, Value::nil, "no such component " + addressText);
+
+    string methodName(method, method_len);
+    const ProxyMethodEntry* pmethod = pc->findMethod(methodName);
+    if (!pmethod)
+      return luaL_error(lua, "no such method: %s", methodName.c_str());
+
+    entry = { address, method, pc, pmethod };
+  }
+
+  // copies, the invoked method may add or remove components
+  Component* pc = entry.component;
+  const ProxyMethodEntry* pmethod = entry.pmethod;
+
   // we remove address and the method name from the stack so that invoked methods can expect their args to start at 1
-  string address = Value::checkArg<string>(lua, 1);
   lua_remove(lua, 1);
-  string methodName = Value::checkArg<string>(lua, 1);
   lua_remove(lua, 1);
 
-  Component* pc = component(address);
-  if (!pc)
-    return ValuePack::ret(lua, Value::nil, "no such component " + address);
-
-  int stacked = pc->invoke(methodName, lua);
+  int stacked = pc->invoke(pmethod, lua);
   lua_pushboolean(lua, true);
   lua_insert(lua, 1);
   return stacked + 1;
@@ -310,8 +414,35 @@ Computer* Client::computer() const
   return _computer;
 }
 
+SystemApi* Client::system() const
+{
+  return _system.get();
+}
+
 RunState Client::run()
 {
+  auto state = step();
+  if (state != RunState::Continue)
+    return state;
+
+  // idle until a component needs to run again or an event source pushes
+  if (_wake == no_deadline)
+  {
+    _notifier.wait();
+  }
+  else
+  {
+    double timeout = _wake - now();
+    if (timeout > 0)
+      _notifier.wait_for(std::min(timeout, max_wait));
+  }
+
+  return RunState::Continue;
+}
+
+RunState Client::step()
+{
+  _wake = no_deadline;
   for (auto& pc : _components)
   {
     auto state = pc->update();
@@ -324,9 +455,24 @@ RunState Client::run()
   return RunState::Continue;
 }
 
-void Client::pushSignal(const ValuePack& pack)
+double Client::wakeTime() const
+{
+  return _wake;
+}
+
+void Client::wakeAt(double when)
+{
+  _wake = std::min(_wake, when);
+}
+
+EventNotifier* Client::notifier()
+{
+  return &_notifier;
+}
+
+bool Client::pushSignal(const SignalPack& pack)
 {
-  _computer->pushSignal(pack);
+  return _computer->pushSignal(pack);
 }
 
 bool Client::add_component(Value& component_config)
@@ -349,8 +495,9 @@ bool Client::add_component(Value& component_config)
   }
 
   auto addr = pc->address();
+  indexComponent(pc.get());
   _components.push_back(std::move(pc));
-  _computer->pushSignal(ValuePack({ "component_added", addr, type }));
+  _computer->pushSignal({ "component_added", addr, type });
 
   return true;
 }
@@ -362,8 +509,13 @@ bool Client::remove_component(const string& address)
     auto& pc = *it;
     if (pc->address() == address)
     {
-      _computer->pushSignal(ValuePack({ "component_removed", pc->address(), pc->type() }));
+      _computer->pushSignal({ "component_removed", pc->address(), pc->type() });
+      clearInvokeCache();
+      _addresses.erase(pc->address());
       _components.erase(it);
+      // another component may share the address
+      for (auto& other : _components)
+        indexComponent(other.get());
       return true;
     }
   }
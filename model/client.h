@@ -1,9 +1,12 @@
 #pragma once
+#include "io/event.h"
 #include "luaproxy.h"
 #include "model/log.h"
+#include "signal_pack.h"
 #include "value.h"
 
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 class Host;
@@ -11,6 +14,7 @@ class Config;
 class Component;
 class Computer;
 class SandboxMethods;
+class SystemApi;
 enum class RunState;
 
 class Client : public LuaProxy
@@ -20,14 +24,31 @@ public:
   ~Client();
   bool load();
   void close();
+  // boots again without recreating the components, only the computer's lua state is new
+  // on failure the client must be closed and loaded again
+  bool reboot();
   vector<Component*> components(string filter = "", bool exact = false) const;
   Component* component(const string& address) const;
   const string& envPath() const;
   Host* host() const;
   void computer(Computer*);
   Computer* computer() const;
-  void pushSignal(const ValuePack& pack);
+  SystemApi* system() const;
+  bool pushSignal(const SignalPack& pack);
+
+  // runs every component once, then blocks until the client needs to run again
   RunState run();
+  // runs every component once without blocking, the caller is responsible for
+  // calling step again at wakeTime() or when the notifier is signaled
+  RunState step();
+  // std::numeric_limits<double>::max() when no component asked to run again
+  double wakeTime() const;
+
+  // components request the next time the client must run again, one that polls
+  // (e.g. a socket) asks for its next poll, nothing else runs it while the vm idles
+  // run() blocks until the earliest request or until the notifier is signaled
+  void wakeAt(double when);
+  EventNotifier* notifier();
   bool add_component(Value& component_config);
   bool remove_component(const string& address);
 
@@ -45,14 +66,34 @@ public:
 
 protected:
   bool createComponents();
+  void indexComponent(Component* pc);
+  void clearInvokeCache();
   bool postInit();
   bool loadLuaComponentApi();
 
 private:
   vector<std::unique_ptr<Component>> _components;
+  std::unordered_map<string, Component*> _addresses;
+
+  // component.invoke resolutions, keyed by the pointers of the (interned) lua strings
+  // of the address and method name. hits are verified against the strings themselves
+  // because lua may reuse the memory of a collected string
+  struct InvokeCacheEntry
+  {
+    const char* address;
+    const char* method;
+    Component* component;
+    const ProxyMethodEntry* pmethod;
+  };
+  static const size_t invoke_cache_size = 64;
+  InvokeCacheEntry _invoke_cache[invoke_cache_size];
+
   Computer* _computer;
   std::unique_ptr<Config> _config;
+  std::unique_ptr<SystemApi> _system;
   string _env_path;
   Host* _host;
   string _crash;
+  EventNotifier _notifier;
+  double _wake = 0;
 };
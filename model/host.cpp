@@ -64,6 +64,16 @@ void Host::stackLog(const string& stack_log)
   _stack_log = stack_log;
 }
 
+size_t Host::allocSample() const
+{
+  return _alloc_sample;
+}
+
+void Host::allocSample(size_t sample_bytes)
+{
+  _alloc_sample = sample_bytes;
+}
+
 string Host::biosPath() const
 {
   return _bios_path;
@@ -98,3 +108,13 @@ void Host::machinePath(const string& machine_path)
 {
   _machine_path = machine_path;
 }
+
+bool Host::fastReboot() const
+{
+  return _fast_reboot;
+}
+
+void Host::fastReboot(bool enabled)
+{
+  _fast_reboot = enabled;
+}
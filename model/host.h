@@ -20,6 +20,10 @@ public:
   std::string stackLog() const;
   void stackLog(const std::string& stack_log);
 
+  // bytes allocated per sampled allocation when logging allocs
+  size_t allocSample() const;
+  void allocSample(size_t sample_bytes);
+
   std::string biosPath() const;
   void biosPath(const std::string& bios_path);
 
@@ -29,6 +33,10 @@ public:
   std::string machinePath() const;
   void machinePath(const std::string& machine_path);
 
+  // reboots keep the client and its components, only the lua state is opened again
+  bool fastReboot() const;
+  void fastReboot(bool enabled);
+
   typedef std::function<std::unique_ptr<Component>()> GeneratorCallback;
 
   static bool registerComponentType(const std::string& type, GeneratorCallback generator);
@@ -42,9 +50,11 @@ public:
 private:
   std::string _frameType;
   std::string _stack_log;
+  size_t _alloc_sample = 0;
   std::string _bios_path;
   std::string _fonts_path;
   std::string _machine_path;
+  bool _fast_reboot = false;
 
   static std::map<std::string, GeneratorCallback>& generators();
 };
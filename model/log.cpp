@@ -9,7 +9,7 @@ using std::fstream;
 using std::function;
 using std::ofstream;
 
-LoggerContext Logger::s_context{ "" };
+thread_local LoggerContext Logger::s_context{ "" };
 Logger& Logging::lout = Logger::getSingleLogger();
 
 const std::string log_file_name = "log";
@@ -55,7 +55,8 @@ private:
   }                         // cannot create mulitple loggers
   Logger(Logger&) = delete; // no copies
 
-  static LoggerContext s_context;
+  // each thread logs for the vm it is currently running
+  static thread_local LoggerContext s_context;
 };
 
 namespace Logging
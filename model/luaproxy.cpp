@@ -1,5 +1,4 @@
 #include "luaproxy.h"
-#include "drivers/fs_utils.h"
 #include <iostream>
 #include <sstream>
 
@@ -22,39 +21,31 @@ void LuaProxy::name(const string& v)
   _name = v;
 }
 
-int lua_proxy_static_caller(lua_State* lua)
+static int lua_proxy_static_caller(lua_State* lua)
 {
-  lua_pushstring(lua, "instance");        //+1
-  lua_gettable(lua, lua_upvalueindex(1)); //-1,+1
-  auto _this = const_cast<void*>(lua_topointer(lua, -1));
-  lua_pop(lua, 1); //-1
-
-  if (!_this)
+  auto* p = static_cast<LuaProxy*>(lua_touserdata(lua, lua_upvalueindex(1)));
+  auto* pmethod = static_cast<const ProxyMethod*>(lua_touserdata(lua, lua_upvalueindex(2)));
+  if (!p || !pmethod)
   {
-    luaL_error(lua, "invalid callback, no instance pointer in closure");
-    return 0;
+    return luaL_error(lua, "invalid callback, no instance pointer in closure");
   }
 
-  lua_pushstring(lua, "name");            //+1
-  lua_gettable(lua, lua_upvalueindex(1)); //-1,+1
-  string methodName = lua_tostring(lua, -1);
-  lua_pop(lua, 1); //-1
-
-  LuaProxy* p = reinterpret_cast<LuaProxy*>(_this);
-
-  int stacked = 0;
-  if (!fs_utils::run_safely(
-      [&stacked, &p, &methodName, &lua]() {
-        stacked = p->invoke(methodName, lua);
-      },
-      [&lua](const string& exception_message) {
-        luaL_error(lua, exception_message.c_str());
-      }))
+  string exception_message;
+  try
+  {
+    return (p->*(*pmethod))(lua);
+  }
+  catch (std::exception& exp)
   {
-    stacked = 0;
+    exception_message = exp.what();
+  }
+  catch (...)
+  {
+    exception_message = "unknown exception";
   }
 
-  return stacked;
+  // raise outside of the catch, luaL_error does not return
+  return luaL_error(lua, "%s", exception_message.c_str());
 }
 
 vector<LuaMethod> LuaProxy::methods() const
@@ -62,15 +53,29 @@ vector<LuaMethod> LuaProxy::methods() const
   vector<LuaMethod> result;
   for (const auto& pair : _methods)
   {
-    result.push_back(std::make_tuple(pair.first, false, &lua_proxy_static_caller));
+    result.push_back(std::make_tuple(pair.first, false, &lua_proxy_static_caller, &pair.second));
   }
   for (const auto& pair : _cmethods)
   {
-    result.push_back(std::make_tuple(pair.first, true, pair.second));
+    result.push_back(std::make_tuple(pair.first, true, pair.second, nullptr));
   }
   return result;
 }
 
+void LuaProxy::pushMethod(lua_State* lua, const LuaMethod& method)
+{
+  lua_CFunction pf = std::get<2>(method);
+  if (std::get<1>(method))
+  {
+    lua_pushcfunction(lua, pf);
+    return;
+  }
+
+  lua_pushlightuserdata(lua, this);
+  lua_pushlightuserdata(lua, const_cast<ProxyMethod*>(std::get<3>(method)));
+  lua_pushcclosure(lua, pf, 2);
+}
+
 const string& LuaProxy::doc(const string& methodName) const
 {
   static const string no_docs = "";
@@ -93,14 +98,27 @@ void LuaProxy::cadd(const string& methodName, lua_CFunction cfunction)
 
 int LuaProxy::invoke(const string& methodName, lua_State* lua)
 {
-  const auto& mit = _methods.find(methodName);
-  if (mit == _methods.end())
+  const ProxyMethodEntry* method = findMethod(methodName);
+  if (!method)
   {
     std::stringstream ss;
     ss << "no such method: " << methodName;
     luaL_error(lua, ss.str().c_str());
   }
 
-  ProxyMethod pmethod = mit->second;
+  return invoke(method, lua);
+}
+
+const ProxyMethodEntry* LuaProxy::findMethod(const string& methodName) const
+{
+  const auto& mit = _methods.find(methodName);
+  if (mit == _methods.end())
+    return nullptr;
+  return &*mit;
+}
+
+int LuaProxy::invoke(const ProxyMethodEntry* method, lua_State* lua)
+{
+  ProxyMethod pmethod = method->second;
   return ((*this).*pmethod)(lua);
 }
@@ -10,7 +10,10 @@ using std::unordered_map;
 
 class LuaProxy;
 typedef int (LuaProxy::*ProxyMethod)(lua_State* lua);
-typedef tuple<string, bool, lua_CFunction> LuaMethod;
+// name, is static (no upvalues), function, method for the instance closure (nullptr for statics)
+// instance closures carry the instance and the method pointer as upvalues, see pushMethod
+typedef tuple<string, bool, lua_CFunction, const ProxyMethod*> LuaMethod;
+typedef std::pair<const string, ProxyMethod> ProxyMethodEntry;
 
 class LuaProxy
 {
@@ -24,8 +27,13 @@ public:
 
   const string& name() const;
   vector<LuaMethod> methods() const;
+  // pushes a callable for the method onto the lua stack
+  void pushMethod(lua_State* lua, const LuaMethod& method);
   const string& doc(const string& methodName) const;
   int invoke(const string& methodName, lua_State* lua);
+  // entries stay valid for the life of the proxy, callers may hold on to them
+  const ProxyMethodEntry* findMethod(const string& methodName) const;
+  int invoke(const ProxyMethodEntry* method, lua_State* lua);
 
 protected:
   void name(const string& v);
@@ -39,6 +47,7 @@ protected:
   void cadd(const string& methodName, lua_CFunction cfunction);
 
 private:
+  // closures point into _methods, methods must not be removed once added
   unordered_map<string, ProxyMethod> _methods;
   unordered_map<string, string> _docs;
   unordered_map<string, lua_CFunction> _cmethods; // for statics - faster dispatch
@@ -0,0 +1,258 @@
+#include "machine_pool.h"
+#include "client.h"
+#include "components/component.h"
+#include "host.h"
+#include "model/log.h"
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <thread>
+
+using std::unique_lock;
+using std::chrono::duration;
+using std::chrono::duration_cast;
+using std::chrono::system_clock;
+
+enum class MachineState
+{
+  Queued,
+  Running,
+  Parked,
+  Done
+};
+
+struct MachinePool::Machine
+{
+  string env_path;
+  unique_ptr<Client> client;
+  MachineState state = MachineState::Running;
+  bool pending = false; // an event source pushed while the machine was running
+  double wake = 0;
+  string crash;
+};
+
+// a far wake time is waited for in parts, the clock can't hold arbitrary durations
+static const double max_wait = 24 * 60 * 60;
+
+inline double now()
+{
+  return duration_cast<duration<double>>(system_clock::now().time_since_epoch()).count();
+}
+
+MachinePool::MachinePool(Host* host, size_t threads)
+    : _host(host)
+    , _threads(std::max<size_t>(threads, 1))
+{
+}
+
+MachinePool::~MachinePool()
+{
+}
+
+void MachinePool::add(const string& env_path)
+{
+  unique_ptr<Machine> m(new Machine);
+  m->env_path = env_path;
+  _machines.push_back(std::move(m));
+}
+
+vector<string> MachinePool::run()
+{
+  size_t threads = std::min(_threads, _machines.size());
+  _queues.clear();
+  for (size_t i = 0; i < threads; i++)
+    _queues.emplace_back(new RunQueue);
+
+  for (auto& pm : _machines)
+  {
+    Machine* m = pm.get();
+    Logger::context({ m->env_path });
+    bool loaded = boot(m);
+
+    unique_lock<mutex> lk(_m);
+    if (loaded)
+    {
+      _active++;
+      schedule(m, _next_queue++ % _queues.size());
+    }
+    else
+    {
+      m->state = MachineState::Done;
+    }
+  }
+
+  vector<std::thread> pool;
+  for (size_t i = 0; i < _queues.size(); i++)
+    pool.emplace_back(&MachinePool::proc, this, i);
+  for (auto& t : pool)
+    t.join();
+
+  vector<string> reports;
+  for (auto& m : _machines)
+    reports.push_back(m->crash);
+  return reports;
+}
+
+bool MachinePool::boot(Machine* m)
+{
+  m->client.reset(new Client(_host, m->env_path));
+  m->client->notifier()->forward([this, m] { wake(m); });
+  if (m->client->load())
+    return true;
+
+  m->crash = m->client->getAllCrashText();
+  m->client.reset();
+  return false;
+}
+
+void MachinePool::proc(size_t index)
+{
+  while (true)
+  {
+    Machine* m = take(index);
+    if (m)
+    {
+      step(m, index);
+      continue;
+    }
+
+    unique_lock<mutex> lk(_m);
+    if (_active == 0)
+      break;
+
+    // machines are only queued while _m is held, nothing can be queued behind our back
+    if (_queued > 0)
+      continue;
+
+    double t = now();
+    double next = std::numeric_limits<double>::max();
+    bool promoted = false;
+    for (auto& pm : _machines)
+    {
+      if (pm->state != MachineState::Parked)
+        continue;
+      if (pm->wake <= t)
+      {
+        schedule(pm.get(), index);
+        promoted = true;
+      }
+      else
+      {
+        next = std::min(next, pm->wake);
+      }
+    }
+
+    if (promoted)
+      continue;
+
+    if (next == std::numeric_limits<double>::max())
+      _cv.wait(lk);
+    else
+      _cv.wait_for(lk, duration<double>(std::min(next - t, max_wait)));
+  }
+  _cv.notify_all();
+}
+
+MachinePool::Machine* MachinePool::take(size_t index)
+{
+  // our own queue from the back (most recently scheduled), the others from the front
+  size_t count = _queues.size();
+  for (size_t i = 0; i < count; i++)
+  {
+    RunQueue& q = *_queues[(index + i) % count];
+    unique_lock<mutex> lk(q.m);
+    if (q.machines.empty())
+      continue;
+
+    Machine* m;
+    if (i == 0)
+    {
+      m = q.machines.back();
+      q.machines.pop_back();
+    }
+    else
+    {
+      m = q.machines.front();
+      q.machines.pop_front();
+    }
+    _queued--;
+    return m;
+  }
+  return nullptr;
+}
+
+void MachinePool::step(Machine* m, size_t index)
+{
+  {
+    unique_lock<mutex> lk(_m);
+    m->state = MachineState::Running;
+    m->pending = false;
+  }
+
+  Logger::context({ m->env_path });
+  RunState state = m->client->step();
+  if (state == RunState::Reboot && _host->fastReboot() && m->client->reboot())
+  {
+    state = RunState::Continue;
+  }
+  else if (state == RunState::Reboot)
+  {
+    m->client.reset();
+    if (!boot(m))
+      state = RunState::Halt;
+  }
+
+  if (state == RunState::Halt)
+  {
+    if (m->client)
+    {
+      m->crash = m->client->getAllCrashText();
+      m->client.reset();
+    }
+
+    unique_lock<mutex> lk(_m);
+    m->state = MachineState::Done;
+    _active--;
+    _cv.notify_all();
+    return;
+  }
+
+  double wake = m->client->wakeTime();
+  unique_lock<mutex> lk(_m);
+  if (m->pending || wake <= now())
+  {
+    schedule(m, index);
+  }
+  else
+  {
+    m->state = MachineState::Parked;
+    m->wake = wake;
+    // an idle thread may be waiting on a later deadline
+    _cv.notify_one();
+  }
+}
+
+// _m must be held
+void MachinePool::schedule(Machine* m, size_t index)
+{
+  m->state = MachineState::Queued;
+  _queued++;
+  RunQueue& q = *_queues[index];
+  unique_lock<mutex> lk(q.m);
+  q.machines.push_back(m);
+}
+
+void MachinePool::wake(Machine* m)
+{
+  unique_lock<mutex> lk(_m);
+  if (m->state == MachineState::Parked)
+  {
+    schedule(m, _next_queue++ % _queues.size());
+    _cv.notify_one();
+  }
+  else if (m->state == MachineState::Running)
+  {
+    m->pending = true;
+  }
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using std::deque;
+using std::mutex;
+using std::string;
+using std::unique_ptr;
+using std::vector;
+
+class Client;
+class Host;
+
+// Runs many vms in one process on a pool of threads
+// Each vm has its own client, computer and lua state. Any pool thread may step a vm,
+// but only one thread steps a given vm at a time.
+// Every thread has its own run queue, and steals from the other queues when its own runs dry.
+// A vm with nothing to do is parked until its client's wake time or until one of its
+// event sources pushes.
+class MachinePool
+{
+public:
+  MachinePool(Host* host, size_t threads);
+  ~MachinePool();
+
+  void add(const string& env_path);
+
+  // blocks until every vm has shutdown
+  // returns the crash report of each vm, in the order they were added
+  vector<string> run();
+
+private:
+  struct Machine;
+  struct RunQueue
+  {
+    mutex m;
+    deque<Machine*> machines;
+  };
+
+  bool boot(Machine* m);
+  void proc(size_t index);
+  Machine* take(size_t index);
+  void step(Machine* m, size_t index);
+  void schedule(Machine* m, size_t index);
+  void wake(Machine* m);
+
+  Host* _host;
+  size_t _threads;
+  vector<unique_ptr<Machine>> _machines;
+  vector<unique_ptr<RunQueue>> _queues;
+
+  // guards machine states
+  // never held while a client runs, clients wake machines (e.g. pushing signals) while stepping
+  mutex _m;
+  std::condition_variable _cv;
+  size_t _active = 0;
+  size_t _next_queue = 0;
+  std::atomic<size_t> _queued { 0 };
+};
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+
+// Binary allocation profile, as written by ProfLog and read by tools/prof_report
+// file: ProfHeader, then a stream of ProfRecords
+// a StackRecord is followed by `size` bytes of stack trace text, and always precedes
+// the first AllocRecord that references its id
+namespace ProfFormat
+{
+static const char magic[8] = { 'o', 'c', 'p', 'r', 'o', 'f', 0, 1 };
+
+struct ProfHeader
+{
+  char magic[8];
+  uint64_t sample_bytes; // one allocation is sampled per this many bytes allocated
+};
+
+enum RecordKind : uint32_t
+{
+  StackRecord = 1,
+  AllocRecord = 2,
+  FreeRecord = 3
+};
+
+struct ProfRecord
+{
+  uint32_t kind;
+  uint32_t stack; // stack id
+  uint64_t ptr;
+  uint64_t size;   // Alloc: block size, Stack: text length
+  uint64_t weight; // Alloc: bytes allocated since the previous sample, this one included
+};
+};
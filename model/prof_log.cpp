@@ -1,34 +1,37 @@
 #include "prof_log.h"
+#include "model/log.h"
 
-#include <fstream>
-#include <sstream>
-using std::endl;
-using std::fstream;
-using std::ofstream;
-using std::stringstream;
+#include <chrono>
+#include <cstring>
 
-ofstream open_file(const string& filename, bool append)
+using Logging::lout;
+using namespace ProfFormat;
+
+ProfLog::Writer::Writer(EventQueue* events, FILE* file)
+    : _events(events)
+    , _file(file)
 {
-  return ofstream(filename, append ? fstream::app : fstream::out);
 }
 
-bool ProfLog::open(const string& dump_file)
+bool ProfLog::Writer::onStart()
 {
-  _filename = "";
-  if (dump_file.empty())
-    return false;
+  return true;
+}
 
-  ofstream ofs = open_file(dump_file, false);
-  bool ok = ofs.is_open();
-  if (ok)
-    _filename = dump_file;
-  ofs.close();
-  return ok;
+bool ProfLog::Writer::runOnce()
+{
+  _events->drain([this](const Event& ev) {
+    fwrite(&ev.record, sizeof(ev.record), 1, _file);
+    if (ev.text)
+      fwrite(ev.text->data(), 1, ev.text->size(), _file);
+  });
+  return true;
 }
 
-bool ProfLog::is_open()
+void ProfLog::Writer::onStop()
 {
-  return !_filename.empty();
+  runOnce();
+  fflush(_file);
 }
 
 ProfLog::~ProfLog()
@@ -36,35 +39,95 @@ ProfLog::~ProfLog()
   flush();
 }
 
-void ProfLog::release(void* ptr)
+bool ProfLog::open(const string& dump_file, size_t sample_bytes)
 {
-  stringstream ss;
-  ss << ptr << " " << 0 << endl;
-  push(ss.str());
+  flush();
+  if (dump_file.empty())
+    return false;
+
+  _file = fopen(dump_file.c_str(), "wb");
+  if (!_file)
+    return false;
+
+  _sample_bytes = sample_bytes > 0 ? sample_bytes : 1;
+  _since_sample = 0;
+
+  ProfHeader header;
+  std::memcpy(header.magic, ProfFormat::magic, sizeof(header.magic));
+  header.sample_bytes = _sample_bytes;
+  fwrite(&header, sizeof(header), 1, _file);
+
+  _events.reset(new EventQueue);
+  _writer.reset(new Writer(_events.get(), _file));
+  _writer->start();
+  return true;
 }
 
-void ProfLog::trace(const string& stacktrace, void* ptr, size_t size)
+bool ProfLog::is_open() const
 {
-  stringstream ss;
-  ss << ptr << " " << size << " " << stacktrace << endl;
-  push(ss.str());
+  return _file != nullptr;
 }
 
-void ProfLog::flush()
+size_t ProfLog::sample(size_t size)
+{
+  _since_sample += size;
+  if (_since_sample < _sample_bytes)
+    return 0;
+
+  size_t weight = _since_sample;
+  _since_sample = 0;
+  return weight;
+}
+
+void ProfLog::trace(const string& stacktrace, void* ptr, size_t size, size_t weight)
 {
-  ofstream ofs = open_file(_filename, true);
-  for (const auto& text : _buffer)
-    ofs << text;
-  ofs.close();
-  _buffer.clear();
+  auto it = _stacks.find(stacktrace);
+  if (it == _stacks.end())
+  {
+    uint32_t id = static_cast<uint32_t>(_stacks.size()) + 1;
+    it = _stacks.emplace(stacktrace, id).first;
+    // map nodes are stable, the writer reads the interned text through the pointer
+    push({ { StackRecord, id, 0, it->first.size(), 0 }, &it->first });
+  }
+
+  _live.insert(ptr);
+  push({ { AllocRecord, it->second, reinterpret_cast<uint64_t>(ptr), size, weight }, nullptr });
 }
 
-void ProfLog::push(const string& text)
+void ProfLog::release(void* ptr)
 {
-  _buffer.push_back(text);
+  // only sampled blocks are of interest
+  if (_live.erase(ptr) == 0)
+    return;
+
+  push({ { FreeRecord, 0, reinterpret_cast<uint64_t>(ptr), 0, 0 }, nullptr });
+}
 
-  if (_buffer.size() > 10000)
+void ProfLog::flush()
+{
+  if (_writer)
+  {
+    _writer->stop();
+    _writer.reset();
+  }
+  _events.reset();
+
+  if (_file)
   {
-    flush();
+    fclose(_file);
+    _file = nullptr;
+    if (_dropped)
+      lout << "allocation profile dropped " << _dropped << " records\n";
   }
+
+  _stacks.clear();
+  _live.clear();
+  _dropped = 0;
+}
+
+void ProfLog::push(const Event& ev)
+{
+  // the writer normally keeps up, wait for it rather than lose records
+  if (!_events->push_wait(ev, std::chrono::milliseconds(1000)))
+    _dropped++;
 }
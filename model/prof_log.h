@@ -1,22 +1,70 @@
 #pragma once
 
+#include "drivers/worker.h"
+#include "io/mpsc_queue.h"
+#include "model/prof_format.h"
+
+#include <cstdio>
+#include <memory>
 #include <string>
-#include <vector>
+#include <unordered_map>
+#include <unordered_set>
 using std::string;
-using std::vector;
+using std::unordered_map;
+using std::unordered_set;
 
+// Sampling allocation profiler
+// Roughly one allocation per sample_bytes is recorded along with its stack trace.
+// Stack traces are interned to ids, and records are queued to a background thread
+// that writes them to the profile file.
 class ProfLog
 {
 public:
   ~ProfLog();
+  bool open(const string& filename, size_t sample_bytes = default_sample_bytes);
+  bool is_open() const;
+
+  // counts an allocation of size bytes
+  // returns the sample weight if this allocation should be traced, otherwise 0
+  size_t sample(size_t size);
+  void trace(const string& stacktrace, void* ptr, size_t size, size_t weight);
   void release(void* ptr);
-  void trace(const string& stacktrace, void* ptr, size_t size);
   void flush();
-  bool open(const string& filename);
-  bool is_open();
+
+  static const size_t default_sample_bytes = 8 * 1024;
 
 private:
-  void push(const string& text);
-  vector<string> _buffer;
-  string _filename;
+  struct Event
+  {
+    ProfFormat::ProfRecord record;
+    const string* text; // interned stack text, for Stack records
+  };
+  typedef MpscQueue<Event, 4096> EventQueue;
+
+  class Writer : public Worker
+  {
+  public:
+    Writer(EventQueue* events, FILE* file);
+
+  protected:
+    bool onStart() override;
+    bool runOnce() override;
+    void onStop() override;
+
+  private:
+    EventQueue* _events;
+    FILE* _file;
+  };
+
+  void push(const Event& ev);
+
+  std::unique_ptr<EventQueue> _events; // only allocated while open
+  std::unique_ptr<Writer> _writer;
+  FILE* _file = nullptr;
+
+  size_t _sample_bytes = default_sample_bytes;
+  size_t _since_sample = 0;
+  unordered_map<string, uint32_t> _stacks;
+  unordered_set<void*> _live; // sampled blocks not yet released
+  size_t _dropped = 0;
 };
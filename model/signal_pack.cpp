@@ -0,0 +1,332 @@
+#include "signal_pack.h"
+
+#include <cstring>
+
+SignalPack::Arg::Arg(bool b)
+    : type(LUA_TBOOLEAN)
+    , integer(b)
+{
+}
+
+SignalPack::Arg::Arg(int32_t n)
+    : type(LUA_TNUMBER)
+    , isInteger(true)
+    , integer(n)
+{
+}
+
+SignalPack::Arg::Arg(uint32_t n)
+    : type(LUA_TNUMBER)
+    , isInteger(true)
+    , integer(n)
+{
+}
+
+SignalPack::Arg::Arg(int64_t n)
+    : type(LUA_TNUMBER)
+    , isInteger(true)
+    , integer(n)
+{
+}
+
+SignalPack::Arg::Arg(uint64_t n)
+    : type(LUA_TNUMBER)
+    , isInteger(true)
+    , integer(static_cast<int64_t>(n))
+{
+}
+
+SignalPack::Arg::Arg(double d)
+    : type(LUA_TNUMBER)
+    , number(d)
+{
+}
+
+SignalPack::Arg::Arg(const char* cstr)
+    : type(LUA_TSTRING)
+    , text(cstr)
+{
+}
+
+SignalPack::Arg::Arg(const string& text)
+    : type(LUA_TSTRING)
+    , text(text)
+{
+}
+
+SignalPack::Arg::Arg(const vector<char>& text)
+    : type(LUA_TSTRING)
+    , text(text.data(), text.size())
+{
+}
+
+SignalPack::Arg::Arg(string_view text)
+    : type(LUA_TSTRING)
+    , text(text)
+{
+}
+
+SignalPack::SignalPack(std::initializer_list<Arg> args)
+{
+  size_t bytes = 0;
+  for (const auto& arg : args)
+  {
+    bytes++;
+    if (arg.type == LUA_TNUMBER)
+      bytes += sizeof(int64_t);
+    else if (arg.type == LUA_TSTRING)
+      bytes += sizeof(uint32_t) + arg.text.size();
+  }
+  _data.reserve(bytes);
+
+  for (const auto& arg : args)
+    add(arg);
+}
+
+SignalPack::SignalPack(SignalPack&& other) noexcept
+    : _data(std::move(other._data))
+    , _count(other._count)
+{
+  other._count = 0;
+}
+
+SignalPack& SignalPack::operator=(SignalPack&& other) noexcept
+{
+  _data.swap(other._data);
+  std::swap(_count, other._count);
+  other.clear();
+  return *this;
+}
+
+void SignalPack::clear()
+{
+  _data.clear();
+  _count = 0;
+}
+
+size_t SignalPack::size() const
+{
+  return _count;
+}
+
+bool SignalPack::empty() const
+{
+  return _count == 0;
+}
+
+template <typename T>
+void SignalPack::write(const T& value)
+{
+  const char* bytes = reinterpret_cast<const char*>(&value);
+  _data.insert(_data.end(), bytes, bytes + sizeof(T));
+}
+
+void SignalPack::writeTag(Tag tag)
+{
+  _data.push_back(static_cast<char>(tag));
+}
+
+SignalPack& SignalPack::add(const Arg& arg)
+{
+  switch (arg.type)
+  {
+  case LUA_TBOOLEAN:
+    return boolean(arg.integer != 0);
+  case LUA_TNUMBER:
+    return arg.isInteger ? integer(arg.integer) : number(arg.number);
+  case LUA_TSTRING:
+    return text(arg.text);
+  }
+  return nil();
+}
+
+SignalPack& SignalPack::nil()
+{
+  writeTag(Nil);
+  _count++;
+  return *this;
+}
+
+SignalPack& SignalPack::boolean(bool b)
+{
+  writeTag(b ? True : False);
+  _count++;
+  return *this;
+}
+
+SignalPack& SignalPack::integer(int64_t n)
+{
+  writeTag(Integer);
+  write(n);
+  _count++;
+  return *this;
+}
+
+SignalPack& SignalPack::number(double d)
+{
+  writeTag(Number);
+  write(d);
+  _count++;
+  return *this;
+}
+
+SignalPack& SignalPack::text(string_view s)
+{
+  writeTag(String);
+  write(static_cast<uint32_t>(s.size()));
+  _data.insert(_data.end(), s.begin(), s.end());
+  _count++;
+  return *this;
+}
+
+SignalPack& SignalPack::add(lua_State* lua, int index)
+{
+  encode(lua, lua_absindex(lua, index));
+  _count++;
+  return *this;
+}
+
+void SignalPack::encode(lua_State* lua, int index)
+{
+  switch (lua_type(lua, index))
+  {
+  case LUA_TBOOLEAN:
+    writeTag(lua_toboolean(lua, index) ? True : False);
+    return;
+  case LUA_TNUMBER:
+#if LUA_VERSION_NUM > 502
+    if (lua_isinteger(lua, index))
+    {
+      writeTag(Integer);
+      write(static_cast<int64_t>(lua_tointeger(lua, index)));
+      return;
+    }
+#endif
+    writeTag(Number);
+    write(static_cast<double>(lua_tonumber(lua, index)));
+    return;
+  case LUA_TSTRING:
+  {
+    size_t len;
+    const char* str = lua_tolstring(lua, index, &len);
+    writeTag(String);
+    write(static_cast<uint32_t>(len));
+    _data.insert(_data.end(), str, str + len);
+    return;
+  }
+  case LUA_TLIGHTUSERDATA:
+    writeTag(Pointer);
+    write(lua_touserdata(lua, index));
+    return;
+  case LUA_TTABLE:
+    break;
+  default:
+    // functions, userdata and threads do not cross into signals
+    writeTag(Nil);
+    return;
+  }
+
+  writeTag(Table);
+  size_t pairs_at = _data.size();
+  write(uint32_t(0));
+
+  uint32_t pairs = 0;
+  luaL_checkstack(lua, 3, "signal table");
+  lua_pushnil(lua); // push nil as first key for next()
+  while (lua_next(lua, index))
+  {
+    int key_type = lua_type(lua, -2);
+    if (key_type != LUA_TSTRING && key_type != LUA_TNUMBER)
+    {
+      string msg = "value conversion for table keys does not support: ";
+      msg += lua_typename(lua, key_type);
+      luaL_error(lua, msg.c_str());
+      return;
+    }
+    encode(lua, lua_absindex(lua, -2));
+    encode(lua, lua_absindex(lua, -1));
+    pairs++;
+    lua_pop(lua, 1); // only pop value, next retakes the key
+  }
+  std::memcpy(_data.data() + pairs_at, &pairs, sizeof(pairs));
+}
+
+const char* SignalPack::pushValue(lua_State* lua, const char* input) const
+{
+  Tag tag = static_cast<Tag>(*input++);
+  switch (tag)
+  {
+  case Nil:
+    lua_pushnil(lua);
+    break;
+  case False:
+  case True:
+    lua_pushboolean(lua, tag == True);
+    break;
+  case Integer:
+  {
+    int64_t n;
+    std::memcpy(&n, input, sizeof(n));
+    input += sizeof(n);
+    lua_pushinteger(lua, static_cast<lua_Integer>(n));
+    break;
+  }
+  case Number:
+  {
+    double d;
+    std::memcpy(&d, input, sizeof(d));
+    input += sizeof(d);
+    lua_pushnumber(lua, d);
+    break;
+  }
+  case String:
+  {
+    uint32_t len;
+    std::memcpy(&len, input, sizeof(len));
+    input += sizeof(len);
+    lua_pushlstring(lua, input, len);
+    input += len;
+    break;
+  }
+  case Pointer:
+  {
+    void* p;
+    std::memcpy(&p, input, sizeof(p));
+    input += sizeof(p);
+    lua_pushlightuserdata(lua, p);
+    break;
+  }
+  case Table:
+  {
+    uint32_t pairs;
+    std::memcpy(&pairs, input, sizeof(pairs));
+    input += sizeof(pairs);
+    lua_createtable(lua, 0, static_cast<int>(pairs));
+    luaL_checkstack(lua, 2, "signal table");
+    for (uint32_t i = 0; i < pairs; i++)
+    {
+      input = pushValue(lua, input);
+      input = pushValue(lua, input);
+      lua_rawset(lua, -3); // pop, pop
+    }
+    break;
+  }
+  }
+  return input;
+}
+
+int SignalPack::push(lua_State* lua) const
+{
+  lua_settop(lua, 0);
+  luaL_checkstack(lua, static_cast<int>(_count), "too many signal arguments");
+
+  const char* input = _data.data();
+  const char* end = input + _data.size();
+  int count = 0;
+  while (input < end)
+  {
+    input = pushValue(lua, input);
+    count++;
+  }
+  return count;
+}
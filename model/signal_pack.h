@@ -0,0 +1,99 @@
+#pragma once
+
+#include "apis/native-lua.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using std::size_t;
+using std::string;
+using std::string_view;
+using std::vector;
+
+// A signal encoded as a flat buffer of tagged values
+// Producers (on any thread) encode a signal once and the vm decodes it straight onto the
+// machine stack, no Value trees are built in between. Copying a pack into a buffer that is
+// already large enough does not allocate, so queue cells reuse their buffers.
+//
+// Each value is a tag byte followed by its payload:
+//   nil, false, true       no payload
+//   integer                int64
+//   number                 double
+//   string                 uint32 length, bytes
+//   pointer                void* (light userdata)
+//   table                  uint32 pair count, then key and value of each pair
+class SignalPack
+{
+public:
+  // one argument of a signal built in place, e.g. pushSignal({ "key_down", address(), ch, code })
+  struct Arg
+  {
+    Arg(bool b);
+    Arg(int32_t n);
+    Arg(uint32_t n);
+    Arg(int64_t n);
+    Arg(uint64_t n);
+    Arg(double d);
+    Arg(const char* cstr);
+    Arg(const string& text);
+    Arg(const vector<char>& text);
+    Arg(string_view text);
+
+    int type;
+    bool isInteger = false;
+    double number = 0;
+    int64_t integer = 0;
+    string_view text;
+  };
+
+  SignalPack() = default;
+  SignalPack(std::initializer_list<Arg> args);
+  SignalPack(const SignalPack&) = default;
+  SignalPack& operator=(const SignalPack&) = default;
+  // moving swaps the buffers, a popped queue cell keeps the capacity of the previous pop
+  SignalPack(SignalPack&& other) noexcept;
+  SignalPack& operator=(SignalPack&& other) noexcept;
+
+  void clear();
+  // the number of arguments
+  size_t size() const;
+  bool empty() const;
+
+  SignalPack& add(const Arg& arg);
+  SignalPack& nil();
+  SignalPack& boolean(bool b);
+  SignalPack& integer(int64_t n);
+  SignalPack& number(double d);
+  SignalPack& text(string_view s);
+  // encodes the value at index, raises a lua error for table keys that are not strings or numbers
+  SignalPack& add(lua_State* lua, int index);
+
+  // replaces the stack with the arguments, returns the argument count
+  int push(lua_State* lua) const;
+
+private:
+  enum Tag : uint8_t
+  {
+    Nil,
+    False,
+    True,
+    Integer,
+    Number,
+    String,
+    Pointer,
+    Table,
+  };
+
+  template <typename T>
+  void write(const T& value);
+  void writeTag(Tag tag);
+  void encode(lua_State* lua, int index);
+  const char* pushValue(lua_State* lua, const char* input) const;
+
+  vector<char> _data;
+  size_t _count = 0;
+};
@@ -0,0 +1,178 @@
+#include "slab_arena.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+// multiples of 16 keep every block aligned for any lua type
+static const size_t class_sizes[] = { 16, 32, 48, 64, 80, 96, 112, 128, 160, 192, 256, 384, 512 };
+
+SlabArena::SlabArena()
+{
+  for (size_t size : class_sizes)
+    _classes.push_back({ size, nullptr, nullptr, nullptr });
+
+  // maps (size + 15) / 16 to the smallest class that fits
+  size_t ci = 0;
+  for (size_t i = 0; i <= max_slab_size / 16; i++)
+  {
+    while (_classes.at(ci).size < i * 16)
+      ci++;
+    _class_index[i] = static_cast<unsigned char>(ci);
+  }
+}
+
+SlabArena::~SlabArena()
+{
+  reset();
+}
+
+void SlabArena::reset(bool keep_pages)
+{
+  if (!keep_pages)
+  {
+    for (char* page : _pages)
+      ::free(page);
+    _pages.clear();
+  }
+  _carved = 0;
+
+  for (void* block : _oversized)
+    ::free(block);
+  _oversized.clear();
+
+  for (auto& sc : _classes)
+  {
+    sc.free_list = nullptr;
+    sc.bump = sc.bump_end = nullptr;
+  }
+  _used = 0;
+}
+
+SlabArena::SizeClass* SlabArena::sizeClass(size_t size)
+{
+  if (size > max_slab_size)
+    return nullptr;
+  return &_classes[_class_index[(size + 15) / 16]];
+}
+
+void* SlabArena::allocate(size_t size)
+{
+  SizeClass* sc = sizeClass(size);
+  if (!sc)
+    return ::malloc(size);
+
+  if (sc->free_list)
+  {
+    FreeBlock* block = sc->free_list;
+    sc->free_list = block->next;
+    return block;
+  }
+
+  if (sc->bump == sc->bump_end)
+  {
+    char* page;
+    if (_carved < _pages.size())
+    {
+      page = _pages[_carved];
+    }
+    else
+    {
+      page = static_cast<char*>(::malloc(page_size));
+      if (!page)
+        return nullptr;
+      _pages.push_back(page);
+    }
+    _carved++;
+    sc->bump = page;
+    sc->bump_end = page + (page_size / sc->size) * sc->size;
+  }
+
+  void* block = sc->bump;
+  sc->bump += sc->size;
+  return block;
+}
+
+void SlabArena::release(void* ptr, size_t size)
+{
+  SizeClass* sc = sizeClass(size);
+  if (!sc || (!_oversized.empty() && _oversized.erase(ptr)))
+  {
+    ::free(ptr);
+    return;
+  }
+
+  FreeBlock* block = static_cast<FreeBlock*>(ptr);
+  block->next = sc->free_list;
+  sc->free_list = block;
+}
+
+void* SlabArena::realloc(void* ptr, size_t osize, size_t nsize)
+{
+  osize = ptr ? osize : 0; // osize is the lua type tag when ptr is null
+  if (nsize == 0)
+  {
+    if (ptr)
+    {
+      release(ptr, osize);
+      _used -= osize;
+    }
+    return nullptr;
+  }
+
+  void* result;
+  if (!ptr)
+  {
+    result = allocate(nsize);
+  }
+  else
+  {
+    SizeClass* from = sizeClass(osize);
+    SizeClass* to = sizeClass(nsize);
+    if (from && from == to)
+    {
+      result = ptr; // same block size, nothing moves
+    }
+    else if (!from && !to)
+    {
+      result = ::realloc(ptr, nsize);
+    }
+    else
+    {
+      result = allocate(nsize);
+      if (result)
+      {
+        std::memcpy(result, ptr, std::min(osize, nsize));
+        release(ptr, osize);
+      }
+      else if (nsize < osize && from)
+      {
+        // lua expects shrinking to never fail, the old block is large enough
+        // it will be recycled as a block of the smaller size when released
+        result = ptr;
+      }
+      else if (nsize < osize)
+      {
+        // a malloc block shrinking to a slab size stays a malloc block
+        void* shrunk = ::realloc(ptr, to->size);
+        result = shrunk ? shrunk : ptr;
+        try
+        {
+          _oversized.insert(result);
+        }
+        catch (const std::bad_alloc&)
+        {
+          // out of memory twice over, the block is recycled as a slab block and never freed
+        }
+      }
+    }
+  }
+
+  if (!result)
+    return nullptr;
+
+  _used = _used - osize + nsize;
+  _peak = std::max(_peak, _used);
+  return result;
+}
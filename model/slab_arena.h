@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstddef>
+#include <unordered_set>
+#include <vector>
+using std::vector;
+
+// Size class allocator backing a single lua state
+// Small blocks are carved from large pages and recycled through per class free lists,
+// larger blocks fall through to malloc. Lua always reports the size of the block it
+// frees or resizes, so blocks carry no header.
+// used() is a running count of the bytes handed out, updated on every call.
+class SlabArena
+{
+public:
+  SlabArena();
+  ~SlabArena();
+
+  SlabArena(const SlabArena&) = delete;
+  SlabArena& operator=(const SlabArena&) = delete;
+
+  // same contract as lua_Alloc
+  void* realloc(void* ptr, size_t osize, size_t nsize);
+
+  size_t used() const
+  {
+    return _used;
+  }
+
+  size_t peak() const
+  {
+    return _peak;
+  }
+
+  // releases every page at once, the blocks still in use are lost
+  // only call once the lua state using the arena is closed
+  // kept pages are carved again by the next lua state instead of being freed
+  void reset(bool keep_pages = false);
+
+  static const size_t max_slab_size = 512;
+  static const size_t page_size = 64 * 1024;
+
+private:
+  struct FreeBlock
+  {
+    FreeBlock* next;
+  };
+
+  struct SizeClass
+  {
+    size_t size;
+    FreeBlock* free_list;
+    char* bump; // next uncarved block in the current page
+    char* bump_end;
+  };
+
+  void* allocate(size_t size);
+  void release(void* ptr, size_t size);
+  SizeClass* sizeClass(size_t size);
+
+  vector<SizeClass> _classes;
+  unsigned char _class_index[max_slab_size / 16 + 1];
+  vector<char*> _pages;
+  size_t _carved = 0; // pages handed to size classes, the rest are kept for reuse
+  // malloc blocks that shrank to a slab size when no slab block could be had
+  // lua frees them with the small size, they must go back to malloc
+  std::unordered_set<void*> _oversized;
+  size_t _used = 0;
+  size_t _peak = 0;
+};
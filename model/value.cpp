@@ -1,9 +1,240 @@
 #include "value.h"
+#include <algorithm>
 #include <limits>
 #include <sstream>
 
 const Value Value::nil; // the nil
 
+// integer keys 1..n are stored in order in the array part, where a missing key is a none value
+// all other keys are in the hash part, open addressing with linear probing
+// a hash slot is empty when its key is none, and erased when its key is nil
+// integer keys in the hash part are never in 1..array.size()+1, inserting array.size()+1 appends
+// references to values in a table are invalidated by adding new keys to that table
+struct Value::Table
+{
+  struct Slot
+  {
+    Value key;
+    Value value;
+  };
+
+  struct Key
+  {
+    bool isInt;
+    int n;
+    string_view text;
+    size_t hash;
+
+    explicit Key(int key)
+        : isInt(true)
+        , n(key)
+        , hash(static_cast<size_t>((static_cast<uint64_t>(static_cast<uint32_t>(key)) * 0x9E3779B97F4A7C15ull) >> 32))
+    {
+    }
+
+    explicit Key(string_view key)
+        : isInt(false)
+        , n(0)
+        , text(key)
+        , hash(std::hash<string_view>()(key))
+    {
+    }
+
+    bool matches(const Value& key) const
+    {
+      if (isInt)
+        return key._id == LUA_TNUMBER && static_cast<int>(key._number) == n;
+      return key._id == LUA_TSTRING && key.toStringView() == text;
+    }
+
+    Value toValue() const
+    {
+      if (!isInt)
+        return Value(text.data(), text.size());
+      Value key(static_cast<double>(n));
+      key._isInteger = true;
+      return key;
+    }
+  };
+
+  vector<Value> array;
+  vector<Slot> slots;
+  size_t used = 0; // live and erased slots
+  size_t count = 0; // live slots
+  size_t ints = 0; // live slots with integer keys
+
+  bool inArray(int key) const
+  {
+    return key >= 1 && static_cast<size_t>(key) <= array.size();
+  }
+
+  Slot* findSlot(const Key& key)
+  {
+    if (slots.empty())
+      return nullptr;
+
+    size_t mask = slots.size() - 1;
+    for (size_t i = key.hash & mask;; i = (i + 1) & mask)
+    {
+      Slot& slot = slots[i];
+      if (slot.key._id == LUA_TNONE)
+        return nullptr;
+      if (key.matches(slot.key))
+        return &slot;
+    }
+  }
+
+  Value* find(const Key& key)
+  {
+    if (key.isInt && inArray(key.n))
+    {
+      Value& value = array[key.n - 1];
+      return value._id == LUA_TNONE ? nullptr : &value;
+    }
+    if (key.isInt && ints == 0)
+      return nullptr;
+
+    Slot* slot = findSlot(key);
+    return slot ? &slot->value : nullptr;
+  }
+
+  // the value for key, a new key has a nil value
+  Value& insert(const Key& key)
+  {
+    if (key.isInt && inArray(key.n))
+    {
+      Value& value = array[key.n - 1];
+      if (value._id == LUA_TNONE)
+        value._id = LUA_TNIL;
+      return value;
+    }
+
+    if (key.isInt && static_cast<size_t>(key.n) == array.size() + 1)
+    {
+      array.emplace_back();
+      // the keys that follow move from the hash part
+      while (ints > 0)
+      {
+        Key next(static_cast<int>(array.size() + 1));
+        Slot* slot = findSlot(next);
+        if (!slot)
+          break;
+        array.push_back(std::move(slot->value));
+        eraseSlot(*slot);
+      }
+      return array[key.n - 1];
+    }
+
+    Slot* slot = findSlot(key);
+    if (slot)
+      return slot->value;
+
+    if ((used + 1) * 4 > slots.size() * 3)
+      rehash();
+
+    size_t mask = slots.size() - 1;
+    size_t i = key.hash & mask;
+    while (slots[i].key._id == LUA_TSTRING || slots[i].key._id == LUA_TNUMBER)
+      i = (i + 1) & mask;
+
+    Slot& empty = slots[i];
+    if (empty.key._id == LUA_TNONE)
+      used++;
+    count++;
+    if (key.isInt)
+      ints++;
+    empty.key = key.toValue();
+    empty.value = Value::nil;
+    return empty.value;
+  }
+
+  void erase(const Key& key)
+  {
+    if (key.isInt && inArray(key.n))
+    {
+      array[key.n - 1] = Value();
+      array[key.n - 1]._id = LUA_TNONE;
+      while (!array.empty() && array.back()._id == LUA_TNONE)
+        array.pop_back();
+      return;
+    }
+
+    Slot* slot = findSlot(key);
+    if (slot)
+      eraseSlot(*slot);
+  }
+
+  void eraseSlot(Slot& slot)
+  {
+    if (slot.key._id == LUA_TNUMBER)
+      ints--;
+    count--;
+    slot.key = Value::nil;
+    slot.value = Value::nil;
+  }
+
+  void rehash()
+  {
+    size_t capacity = 8;
+    while (capacity < (count + 1) * 2)
+      capacity *= 2;
+
+    vector<Slot> previous(capacity);
+    previous.swap(slots);
+    for (auto& slot : slots)
+      slot.key._id = LUA_TNONE;
+
+    size_t mask = capacity - 1;
+    for (auto& slot : previous)
+    {
+      if (slot.key._id != LUA_TSTRING && slot.key._id != LUA_TNUMBER)
+        continue;
+
+      Key key = slot.key._id == LUA_TNUMBER ? Key(static_cast<int>(slot.key._number)) : Key(slot.key.toStringView());
+      size_t i = key.hash & mask;
+      while (slots[i].key._id != LUA_TNONE)
+        i = (i + 1) & mask;
+      slots[i].key = std::move(slot.key);
+      slots[i].value = std::move(slot.value);
+    }
+    used = count;
+  }
+
+  int maxInt() const
+  {
+    int max = static_cast<int>(array.size());
+    if (ints == 0)
+      return max;
+
+    for (const auto& slot : slots)
+    {
+      if (slot.key._id == LUA_TNUMBER)
+        max = std::max(max, static_cast<int>(slot.key._number));
+    }
+    return max;
+  }
+};
+
+static const string& type_name(int id)
+{
+  static const string names[] = {
+    "no value",
+    "nil",
+    "boolean",
+    "userdata",
+    "number",
+    "string",
+    "table",
+    "function",
+    "userdata",
+    "thread",
+  };
+
+  if (id < LUA_TNONE || id > LUA_TTHREAD)
+    return names[0];
+  return names[id - LUA_TNONE];
+}
+
 static bool validate_argument_type(lua_State* lua, int index, int type_id, bool nilok)
 {
   int top = lua_gettop(lua);
@@ -41,6 +272,20 @@ string Value::checkArg<string>(lua_State* lua, int index, const string* pDefault
   return string(str, len);
 }
 
+template <>
+string_view Value::checkArg<string_view>(lua_State* lua, int index, const string_view* pDefault)
+{
+  bool has_type = validate_argument_type(lua, index, LUA_TSTRING, pDefault);
+
+  if (!has_type)
+    return *pDefault;
+
+  size_t len;
+  const char* str = lua_tolstring(lua, index, &len);
+
+  return string_view(str, len);
+}
+
 template <>
 vector<char> Value::checkArg<vector<char>>(lua_State* lua, int index, const vector<char>* pDefault)
 {
@@ -122,45 +367,38 @@ map<string, string> Value::checkArg<map<string, string>>(lua_State* lua, int ind
 
   map<string, string> result;
   Value t(lua, index);
-  for (const auto& pair : t._stable)
+  for (const auto& key : t.keys())
   {
-    result[pair.first] = pair.second.toString();
+    result[key] = t.get(key).toString();
   }
 
   return result;
 }
 
-Value::Value(const vector<char>& v)
+Value::Value(const char* data, size_t size)
 {
-  _type = "string";
-  _id = LUA_TSTRING;
-  _string = v;
+  assign(data, size);
 }
 
 Value::Value()
 {
-  _id = LUA_TNIL;
-  _type = "nil";
 }
 
 Value::Value(const void* p, bool bLight)
 {
   _id = bLight ? LUA_TLIGHTUSERDATA : LUA_TUSERDATA;
-  _type = "userdata";
   _pointer = const_cast<void*>(p);
 }
 
 Value::Value(bool b)
 {
   _id = LUA_TBOOLEAN;
-  _type = "boolean";
   _bool = b;
 }
 
 Value::Value(uint64_t n)
 {
   _id = LUA_TNUMBER;
-  _type = "number";
   _isInteger = true;
   _number = n;
 }
@@ -168,13 +406,13 @@ Value::Value(uint64_t n)
 Value::Value(double d)
 {
   _id = LUA_TNUMBER;
-  _type = "number";
   _number = d;
 }
 
 Value::Value(lua_State* s)
 {
-  _type = "thread";
+  _id = LUA_TTHREAD;
+  _thread = nullptr;
   _thread_status = lua_status(s);
 
   if (_thread_status == LUA_OK || _thread_status == LUA_YIELD)
@@ -186,21 +424,22 @@ Value::Value(lua_State* s)
     }
     lua_settop(s, top);
   }
-
-  _id = LUA_TTHREAD;
 }
 
 Value::Value(lua_State* lua, int index)
 {
   lua_pushvalue(lua, index);
   _id = lua_type(lua, -1);
-  _type = lua_typename(lua, _id);
 
   switch (_id)
   {
   case LUA_TSTRING:
-    _string = Value::checkArg<vector<char>>(lua, -1, nullptr);
+  {
+    size_t len;
+    const char* str = lua_tolstring(lua, -1, &len);
+    assign(str, len);
     break;
+  }
   case LUA_TBOOLEAN:
     _bool = lua_toboolean(lua, -1);
     break;
@@ -220,6 +459,7 @@ Value::Value(lua_State* lua, int index)
     break;
   case LUA_TTHREAD:
     _thread = lua_tothread(lua, -1);
+    _thread_status = 0;
     break;
   case LUA_TTABLE:
     lua_pushnil(lua); // push nil as first key for next()
@@ -227,19 +467,22 @@ Value::Value(lua_State* lua, int index)
     {
       // return key, value
       Value value(lua, -1);
-      Value key(lua, -2);
-      if (key._id == LUA_TSTRING)
+      int key_id = lua_type(lua, -2);
+      if (key_id == LUA_TSTRING)
       {
-        set(key.toString(), value);
+        size_t len;
+        const char* key = lua_tolstring(lua, -2, &len);
+        if (value._id != LUA_TNIL)
+          entries().insert(Table::Key(string_view(key, len))) = std::move(value);
       }
-      else if (key._id == LUA_TNUMBER)
+      else if (key_id == LUA_TNUMBER)
       {
-        set((int)key._number, value);
+        set((int)lua_tonumber(lua, -2), value);
       }
       else
       {
         string msg = "value conversion for table keys does not support: ";
-        msg += key._type;
+        msg += lua_typename(lua, key_id);
         luaL_error(lua, msg.c_str());
         return;
       }
@@ -250,110 +493,230 @@ Value::Value(lua_State* lua, int index)
   lua_pop(lua, 1);
 }
 
+Value::Value(const Value& other)
+{
+  copyFrom(other);
+}
+
+Value::Value(Value&& other) noexcept
+{
+  moveFrom(other);
+}
+
+Value::~Value()
+{
+  release();
+}
+
+Value& Value::operator=(const Value& other)
+{
+  if (this != &other)
+  {
+    // other may be inside this table
+    Value copy(other);
+    release();
+    moveFrom(copy);
+  }
+  return *this;
+}
+
+Value& Value::operator=(Value&& other) noexcept
+{
+  if (this != &other)
+  {
+    Value moved(std::move(other));
+    release();
+    moveFrom(moved);
+  }
+  return *this;
+}
+
+void Value::assign(const char* data, size_t size)
+{
+  _id = LUA_TSTRING;
+  _size = static_cast<uint32_t>(size);
+  char* buffer = _small;
+  if (size > inline_capacity)
+    buffer = _heap = new char[size];
+  if (size)
+    std::memcpy(buffer, data, size);
+}
+
+const char* Value::chars() const
+{
+  return _size > inline_capacity ? _heap : _small;
+}
+
+void Value::release()
+{
+  if (_id == LUA_TSTRING && _size > inline_capacity)
+    delete[] _heap;
+  delete _table;
+  _table = nullptr;
+  _id = LUA_TNIL;
+}
+
+void Value::copyFrom(const Value& other)
+{
+  if (other._id == LUA_TSTRING)
+  {
+    assign(other.chars(), other._size);
+    return;
+  }
+
+  _id = other._id;
+  _isInteger = other._isInteger;
+  _size = other._size;
+  std::memcpy(_small, other._small, inline_capacity);
+  _table = other._table ? new Table(*other._table) : nullptr;
+}
+
+void Value::moveFrom(Value& other)
+{
+  _id = other._id;
+  _isInteger = other._isInteger;
+  _size = other._size;
+  std::memcpy(_small, other._small, inline_capacity);
+  _table = other._table;
+
+  // other no longer owns the heap string or the table
+  other._id = LUA_TNIL;
+  other._table = nullptr;
+}
+
+Value::Table& Value::entries()
+{
+  if (!_table)
+    _table = new Table;
+  return *_table;
+}
+
 Value Value::table()
 {
   Value t;
   t._id = LUA_TTABLE;
-  t._type = "table";
   return t;
 }
 
 string Value::toString() const
 {
-  if (type() == "string")
-    return string(_string.begin(), _string.end());
+  if (_id == LUA_TSTRING)
+    return string(chars(), _size);
   else
     return serialize();
 }
 
 vector<char> Value::toRawString() const
 {
-  return _string;
+  if (_id != LUA_TSTRING)
+    return {};
+  return vector<char>(chars(), chars() + _size);
+}
+
+string_view Value::toStringView() const
+{
+  if (_id != LUA_TSTRING)
+    return {};
+  return string_view(chars(), _size);
 }
 
 bool Value::toBool() const
 {
-  return _bool;
+  return _id == LUA_TBOOLEAN && _bool;
 }
 
 double Value::toNumber() const
 {
-  return _number;
+  return _id == LUA_TNUMBER ? _number : 0;
 }
 
 void* Value::toPointer() const
 {
-  return _pointer;
+  return (_id == LUA_TLIGHTUSERDATA || _id == LUA_TUSERDATA) ? _pointer : nullptr;
 }
 
 lua_State* Value::toThread() const
 {
-  return _thread;
+  return _id == LUA_TTHREAD ? _thread : nullptr;
 }
 
 int Value::status() const
 {
-  return _thread_status;
+  return _id == LUA_TTHREAD ? _thread_status : 0;
 }
 
 const Value& Value::get(const string& key) const
 {
-  const auto& it = _stable.find(key);
-  if (it == _stable.end())
-    return Value::nil;
-
-  return it->second;
+  const Value* value = _table ? _table->find(Table::Key(key)) : nullptr;
+  return value ? *value : Value::nil;
 }
 
 Value& Value::get(const string& key)
 {
-  return _stable[key];
+  return entries().insert(Table::Key(key));
 }
 
 const Value& Value::get(int key) const
 {
-  const auto& it = _ntable.find(key);
-  if (it == _ntable.end())
-    return Value::nil;
-
-  return it->second;
+  const Value* value = _table ? _table->find(Table::Key(key)) : nullptr;
+  return value ? *value : Value::nil;
 }
 
 Value& Value::get(int key)
 {
-  return _ntable[key];
+  return entries().insert(Table::Key(key));
 }
 
 Value& Value::set(const string& key, const Value& value)
 {
   if (value.type_id() == LUA_TNIL)
-    _stable.erase(key);
+  {
+    if (_table)
+      _table->erase(Table::Key(key));
+  }
   else
-    _stable[key] = value;
+  {
+    // value may live in this table, inserting the key can move it
+    Value copy = value;
+    entries().insert(Table::Key(key)) = std::move(copy);
+  }
   return *this;
 }
 Value& Value::set(int key, const Value& value)
 {
   if (value.type_id() == LUA_TNIL)
-    _ntable.erase(key);
+  {
+    if (_table)
+      _table->erase(Table::Key(key));
+  }
   else
-    _ntable[key] = value;
+  {
+    Value copy = value;
+    entries().insert(Table::Key(key)) = std::move(copy);
+  }
   set("n", len());
   return *this;
 }
 bool Value::contains(int key) const
 {
-  return _ntable.find(key) != _ntable.end();
+  return _table && _table->find(Table::Key(key));
 }
 bool Value::contains(const string& key) const
 {
-  return _stable.find(key) != _stable.end();
+  return _table && _table->find(Table::Key(key));
 }
 vector<string> Value::keys() const
 {
   vector<string> result;
-  for (const auto& key : _stable)
-    result.push_back(key.first);
+  if (!_table)
+    return result;
+
+  for (const auto& slot : _table->slots)
+  {
+    if (slot.key._id == LUA_TSTRING)
+      result.push_back(slot.key.toString());
+  }
+  std::sort(result.begin(), result.end());
   return result;
 }
 
@@ -367,23 +730,16 @@ Value& Value::insert(const Value& value)
 int Value::len() const
 {
   if (_id == LUA_TSTRING)
-    return (int)_string.size();
+    return (int)_size;
   else if (_id == LUA_TTHREAD || _id == LUA_TTABLE)
-  {
-    int max = 0;
-    for (const auto& pair : _ntable)
-    {
-      max = std::max(max, pair.first);
-    }
-    return max;
-  }
+    return _table ? _table->maxInt() : 0;
 
   return 0;
 }
 
-string Value::type() const
+const string& Value::type() const
 {
-  return _type;
+  return type_name(_id);
 }
 
 int Value::type_id() const
@@ -403,7 +759,7 @@ string Value::serialize(bool pretty, int depth) const
   std::stringstream ss;
   if (_id == LUA_TSTRING)
   {
-    ss << quote_string(string(_string.begin(), _string.end()));
+    ss << quote_string(toString());
   }
   else if (_id == LUA_TBOOLEAN)
   {
@@ -435,7 +791,7 @@ string Value::serialize(bool pretty, int depth) const
     int count = len();
     for (int n = 1; n <= count; n++)
     {
-      if (_ntable.find(n) == _ntable.end())
+      if (!contains(n))
       {
         skipped_index = true;
         continue;
@@ -447,12 +803,12 @@ string Value::serialize(bool pretty, int depth) const
         number_ss << "[" << n << "]=";
         key = number_ss.str();
       }
-      kvs.push_back(key + _ntable.at(n).serialize(pretty, depth + 1));
+      kvs.push_back(key + get(n).serialize(pretty, depth + 1));
     }
     for (const string& key : keys())
     {
       string keytext = "[" + quote_string(key) + "]=";
-      string value = _stable.at(key).serialize(pretty, depth + 1);
+      string value = get(key).serialize(pretty, depth + 1);
       kvs.push_back(keytext + value);
     }
 
@@ -483,7 +839,7 @@ string Value::serialize(bool pretty, int depth) const
   }
   else
   {
-    ss << "[" << _type << "]";
+    ss << "[" << type() << "]";
   }
   if (pretty && !depth)
     ss << "\n";
@@ -501,7 +857,7 @@ bool Value::operator<(const Value& rhs) const
     return _number < rhs._number;
     break;
   case LUA_TSTRING:
-    return _string < rhs._string;
+    return std::lexicographical_compare(chars(), chars() + _size, rhs.chars(), rhs.chars() + rhs._size);
     break;
   }
   return false;
@@ -509,7 +865,7 @@ bool Value::operator<(const Value& rhs) const
 
 Value::operator bool() const
 {
-  return _type != "nil" && (_type != "boolean" || _bool);
+  return _id != LUA_TNIL && (_id != LUA_TBOOLEAN || _bool);
 }
 
 void Value::push(lua_State* lua) const
@@ -517,7 +873,7 @@ void Value::push(lua_State* lua) const
   switch (_id)
   {
   case LUA_TSTRING:
-    lua_pushlstring(lua, _string.data(), _string.size());
+    lua_pushlstring(lua, chars(), _size);
     break;
   case LUA_TBOOLEAN:
     lua_pushboolean(lua, _bool);
@@ -535,18 +891,27 @@ void Value::push(lua_State* lua) const
     lua_pushthread(_thread);
     break;
   case LUA_TTABLE:
-    lua_newtable(lua);
-    for (const auto& pair : _ntable)
+    if (!_table)
+    {
+      lua_newtable(lua);
+      break;
+    }
+    lua_createtable(lua, static_cast<int>(_table->array.size()), static_cast<int>(_table->count));
+    for (size_t i = 0; i < _table->array.size(); i++)
     {
-      Value(pair.first).push(lua);
-      pair.second.push(lua);
-      lua_settable(lua, -3); // pop, pop
+      const Value& value = _table->array[i];
+      if (value._id == LUA_TNONE)
+        continue;
+      value.push(lua);
+      lua_rawseti(lua, -2, static_cast<int>(i + 1));
     }
-    for (const auto& pair : _stable)
+    for (const auto& slot : _table->slots)
     {
-      Value(pair.first).push(lua);
-      pair.second.push(lua);
-      lua_settable(lua, -3); // pop, pop
+      if (slot.key._id != LUA_TSTRING && slot.key._id != LUA_TNUMBER)
+        continue;
+      slot.key.push(lua);
+      slot.value.push(lua);
+      lua_rawset(lua, -3); // pop, pop
     }
     break;
   case LUA_TUSERDATA:
@@ -556,7 +921,6 @@ void Value::push(lua_State* lua) const
     break;
   }
 }
-
 ValuePack::ValuePack(std::initializer_list<Value> values)
 {
   for (const auto& v : values)
@@ -601,7 +965,8 @@ string Value::stack(lua_State* state)
   // creating a stack trace allocates memory for the strings
   // to keep the quiet on the machine lua state we can
   // use a lua state specifically for allocation
-  static lua_State* stack_state = luaL_newstate();
+  // one per thread, vms can be run from multiple threads
+  static thread_local lua_State* stack_state = luaL_newstate();
   luaL_traceback(stack_state, state, nullptr, 1);
   string stacktrace = string(lua_tostring(stack_state, -1));
   lua_pop(stack_state, 1);
@@ -611,13 +976,18 @@ string Value::stack(lua_State* state)
 vector<std::tuple<Value, Value*>> Value::pairs()
 {
   vector<std::tuple<Value, Value*>> result;
-  for (auto& pair : _ntable)
+  if (!_table)
+    return result;
+
+  for (size_t i = 0; i < _table->array.size(); i++)
   {
-    result.push_back(std::make_tuple(pair.first, &pair.second));
+    if (_table->array[i]._id != LUA_TNONE)
+      result.push_back(std::make_tuple(Value(static_cast<int>(i + 1)), &_table->array[i]));
   }
-  for (auto& pair : _stable)
+  for (auto& slot : _table->slots)
   {
-    result.push_back(std::make_tuple(pair.first, &pair.second));
+    if (slot.key._id == LUA_TSTRING || slot.key._id == LUA_TNUMBER)
+      result.push_back(std::make_tuple(slot.key, &slot.value));
   }
   return result;
 }
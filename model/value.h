@@ -2,9 +2,12 @@
 
 #include "apis/native-lua.h"
 
+#include <cstdint>
+#include <cstring>
 #include <map>
 #include <memory>
 #include <string>
+#include <string_view>
 #include <vector>
 
 using std::map;
@@ -12,17 +15,18 @@ using std::ostream;
 using std::shared_ptr;
 using std::size_t;
 using std::string;
+using std::string_view;
 using std::vector;
 
 class Value
 {
 public:
-  Value(const vector<char>& v);
-  Value(const string& v) : Value(vector<char>(v.begin(), v.end())) {}
+  Value(const vector<char>& v) : Value(v.data(), v.size()) {}
+  Value(const string& v) : Value(v.data(), v.size()) {}
   Value(bool b);
   Value(double d);
   Value(const void* p, bool bLight);
-  Value(const char* cstr) : Value(string(cstr)) {}
+  Value(const char* cstr) : Value(cstr, std::strlen(cstr)) {}
 
   Value(uint64_t n);
   Value(int64_t n) : Value(uint64_t(n)) {}
@@ -33,6 +37,12 @@ public:
   Value(lua_State*, int);
 
   Value();
+  Value(const Value& other);
+  Value(Value&& other) noexcept;
+  ~Value();
+
+  Value& operator=(const Value& other);
+  Value& operator=(Value&& other) noexcept;
 
   static string stack(lua_State* state);
   static Value table();
@@ -44,17 +54,22 @@ public:
 
   Value& insert(const Value& value);
   int len() const;
-  string type() const;
+  // the lua type name, interned
+  const string& type() const;
   int type_id() const;
 
   string toString() const;
   vector<char> toRawString() const;
+  // valid until this value changes
+  string_view toStringView() const;
   double toNumber() const;
   bool toBool() const;
   void* toPointer() const;
   lua_State* toThread() const;
   int status() const;
 
+  // checkArg<string_view> does not copy, the view points into the lua string
+  // and is only valid while the argument is on the stack, i.e. for the duration of the call
   template <typename T>
   static T checkArg(lua_State* lua, int index, const T* pDefault = nullptr);
 
@@ -75,17 +90,36 @@ public:
   bool operator<(const Value& rhs) const;
 
 private:
-  string _type;
-  int _id;
-  vector<char> _string;
-  bool _bool = false;
-  double _number = 0;
+  // strings up to this size (e.g. component addresses) are stored in the value
+  static const size_t inline_capacity = 40;
+  struct Table;
+
+  Value(const char* data, size_t size);
+  void assign(const char* data, size_t size);
+  const char* chars() const;
+  void release();
+  void copyFrom(const Value& other);
+  void moveFrom(Value& other);
+  Table& entries();
+
+  // a value is 56 bytes, tables and long strings are allocated on demand
+  int8_t _id = LUA_TNIL;
   bool _isInteger = false;
-  void* _pointer = nullptr;
-  lua_State* _thread = nullptr;
-  int _thread_status = 0;
-  map<string, Value> _stable;
-  map<int, Value> _ntable;
+  union
+  {
+    uint32_t _size = 0; // string length
+    int _thread_status;
+  };
+  union
+  {
+    bool _bool;
+    double _number;
+    void* _pointer = nullptr;
+    lua_State* _thread;
+    char* _heap;
+    char _small[inline_capacity];
+  };
+  Table* _table = nullptr;
 };
 
 struct ValuePack : public vector<Value>
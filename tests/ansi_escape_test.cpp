@@ -0,0 +1,79 @@
+#include "drivers/ansi.h"
+#include "drivers/ansi_escape.h"
+#include "tests/test.h"
+
+#include <string>
+#include <fcntl.h>
+#include <unistd.h>
+
+// writes cells and renders them, capturing what goes to the terminal
+class TestTerm : public AnsiEscapeTerm
+{
+public:
+  void put(int x, int y, uint32_t codepoint, int width)
+  {
+    ColorState cst{};
+    cst.depth = EDepthType::_8;
+    onWrite(x, y, { codepoint, Colors::White, Colors::Black, false, width }, cst);
+  }
+
+  std::string render()
+  {
+    int pipes[2];
+    if (::pipe(pipes) != 0)
+      return {};
+    int saved = ::dup(STDOUT_FILENO);
+    ::dup2(pipes[1], STDOUT_FILENO);
+    onPresent();
+    ::dup2(saved, STDOUT_FILENO);
+    ::close(saved);
+    ::close(pipes[1]);
+
+    std::string out;
+    char buffer[4096];
+    ssize_t bytes;
+    while ((bytes = ::read(pipes[0], buffer, sizeof(buffer))) > 0)
+      out.append(buffer, bytes);
+    ::close(pipes[0]);
+    return out;
+  }
+
+  void forget()
+  {
+    render(); // empties the damage
+    // a clear forgets what the terminal shows, as an invalidate does
+    int saved = ::dup(STDOUT_FILENO);
+    int null = ::open("/dev/null", 0);
+    ::dup2(null, STDOUT_FILENO);
+    onClear();
+    std::cout.flush();
+    ::dup2(saved, STDOUT_FILENO);
+    ::close(saved);
+    ::close(null);
+  }
+};
+
+int main()
+{
+  TestTerm term;
+  term.put(1, 1, ' ', 1);
+  term.put(2, 1, 'z', 1); // stale, before the wide glyph was drawn
+  term.put(3, 1, ' ', 1);
+  term.put(1, 1, 0x4E2D, 2); // the gpu locks column 2, it is not written again
+  term.render();
+
+  // an invalidate writes every cell again, but the locked right half
+  term.forget();
+  term.put(1, 1, 0x4E2D, 2);
+  term.put(3, 1, ' ', 1);
+  std::string out = term.render();
+  CHECK(out.find(Ansi::set_pos(2, 1)) == std::string::npos);
+  CHECK(out.find('z') == std::string::npos);
+
+  // a narrow glyph replacing the right half is drawn
+  term.put(2, 1, 'y', 1);
+  out = term.render();
+  CHECK(out.find('y') != std::string::npos);
+
+  return TEST_RESULT();
+}
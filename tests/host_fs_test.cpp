@@ -0,0 +1,50 @@
+#include "drivers/fs_utils.h"
+#include "drivers/host_fs.h"
+#include "tests/test.h"
+
+#include <cstdlib>
+#include <string>
+#include <unistd.h>
+
+static void write(HostFs& fs, const std::string& path, const std::string& data)
+{
+  auto file = fs.open(path, FsBackend::OpenMode::Write);
+  CHECK(file != nullptr);
+  if (file)
+    CHECK(file->write(data));
+}
+
+int main()
+{
+  std::string root = "/tmp/ocvm_host_fs_test_" + std::to_string(::getpid());
+  fs_utils::mkdir(root + "/a");
+
+  {
+    HostFs fs(root, false, 16);
+
+    // the same file through paths that are not canonical is counted once
+    write(fs, "/a//b", "12345678");
+    fs.update(); // inotify reports the close under the canonical path
+    CHECK(fs.spaceUsed() == 8);
+
+    write(fs, "a/./b", "87654321");
+    fs.update();
+    CHECK(fs.spaceUsed() == 8);
+
+    // the capacity is not used up by the duplicates
+    write(fs, "/a/../a/c", "12345678");
+    fs.update();
+    CHECK(fs.spaceUsed() == 16);
+    CHECK(fs.exists("/a/c"));
+
+    // .. stops at the root
+    CHECK(fs.exists("/../../a/b"));
+
+    CHECK(fs.remove("/a//b"));
+    fs.update();
+    CHECK(fs.spaceUsed() == 8);
+  }
+
+  fs_utils::remove(root);
+  return TEST_RESULT();
+}
@@ -0,0 +1,33 @@
+#include "drivers/ram_fs.h"
+#include "tests/test.h"
+
+#include <string>
+
+int main()
+{
+  RamFs fs(16);
+
+  auto writer = fs.open("/a", FsBackend::OpenMode::Write);
+  CHECK(writer && writer->write("hello"));
+  CHECK(fs.spaceUsed() == 5);
+
+  // a removed file stays readable and writable through the handles still open
+  auto reader = fs.open("/a", FsBackend::OpenMode::Read);
+  CHECK(fs.remove("/a"));
+  CHECK(!fs.exists("/a"));
+  CHECK(fs.spaceUsed() == 0);
+  CHECK(reader && std::string(reader->read(10)) == "hello");
+  CHECK(reader && reader->eof());
+
+  // and is no longer counted, writing past the capacity works
+  CHECK(writer && writer->write(std::string(20, 'x')));
+  CHECK(fs.spaceUsed() == 0);
+
+  // a new file takes the path and the space
+  auto other = fs.open("/a", FsBackend::OpenMode::Write);
+  CHECK(other && other->write("0123456789abcdef"));
+  CHECK(other && !other->write("!"));
+  CHECK(fs.spaceUsed() == 16);
+
+  return TEST_RESULT();
+}
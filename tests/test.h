@@ -0,0 +1,20 @@
+#pragma once
+
+#include <iostream>
+
+// Minimal checks for the unit tests under tests/, each test is its own program
+// run by `make check`, a failed check prints where it failed and the program exits 1
+
+static int test_failures = 0;
+
+#define CHECK(cond)                                                            \
+  do                                                                           \
+  {                                                                            \
+    if (!(cond))                                                               \
+    {                                                                          \
+      std::cerr << __FILE__ << ":" << __LINE__ << ": failed: " #cond "\n";     \
+      test_failures++;                                                         \
+    }                                                                          \
+  } while (0)
+
+#define TEST_RESULT() (test_failures == 0 ? 0 : 1)
@@ -0,0 +1,178 @@
+#include "model/value.h"
+#include "tests/test.h"
+
+#include <algorithm>
+#include <map>
+#include <random>
+#include <string>
+
+// Randomized set/get/insert/copy sequences checked against a model of the table
+// implementation Value had before the hybrid array/hash table: a std::map for integer keys
+// and one for string keys, serialized the way that implementation serialized them.
+// Values are serialized scalars, "nil" is an entry created by a non-const get.
+struct Model
+{
+  std::map<int, std::string> ints;
+  std::map<std::string, std::string> strings;
+
+  int len() const
+  {
+    int max = 0;
+    for (const auto& pair : ints)
+      max = std::max(max, pair.first);
+    return max;
+  }
+
+  void set(int key, const std::string& value)
+  {
+    if (value == "nil")
+      ints.erase(key);
+    else
+      ints[key] = value;
+    strings["n"] = std::to_string(len());
+  }
+
+  void set(const std::string& key, const std::string& value)
+  {
+    if (value == "nil")
+      strings.erase(key);
+    else
+      strings[key] = value;
+  }
+
+  std::string serialize() const
+  {
+    std::string text = "{";
+    bool skipped_index = false;
+    for (int n = 1; n <= len(); n++)
+    {
+      auto it = ints.find(n);
+      if (it == ints.end())
+      {
+        skipped_index = true;
+        continue;
+      }
+      if (skipped_index)
+        text += "[" + std::to_string(n) + "]=";
+      text += it->second + ",";
+    }
+    for (const auto& pair : strings)
+      text += "[\"" + pair.first + "\"]=" + pair.second + ",";
+    return text + "}";
+  }
+};
+
+int main()
+{
+  std::mt19937 rng(20261017);
+  auto pick = [&](int lo, int hi) { return std::uniform_int_distribution<int>(lo, hi)(rng); };
+
+  const char* names[] = { "a", "b", "n", "address", "type", "a fairly long key that is not stored inline" };
+  auto name = [&]() { return std::string(names[pick(0, 5)]); };
+
+  for (int round = 0; round < 200; round++)
+  {
+    Value t = Value::table();
+    Model model;
+
+    for (int step = 0; step < 300; step++)
+    {
+      // a scalar, or nil one time in six
+      Value value;
+      std::string text = "nil";
+      int kind = pick(0, 5);
+      if (kind > 2)
+      {
+        int number = pick(0, 1000); // Value(int) wraps negative numbers, as it always did
+        value = Value(number);
+        text = std::to_string(number);
+      }
+      else if (kind > 0)
+      {
+        std::string str = "s" + std::to_string(pick(0, 99));
+        if (kind == 2)
+          str += std::string(pick(30, 50), 'x'); // past the inline size
+        value = Value(str);
+        text = "\"" + str + "\"";
+      }
+
+      int key = pick(-2, 40);
+      int other = pick(-2, 40);
+      switch (pick(0, 8))
+      {
+      case 0:
+        t.set(key, value);
+        model.set(key, text);
+        break;
+      case 1:
+      {
+        std::string str = name();
+        t.set(str, value);
+        model.set(str, text);
+        break;
+      }
+      case 2:
+        t.insert(value);
+        model.set(model.len() + 1, text);
+        break;
+      case 3:
+        // a non-const get creates a nil entry
+        t.get(key);
+        model.ints.emplace(key, "nil");
+        break;
+      case 4:
+      {
+        // the value set is an element of the same table
+        model.ints.emplace(other, "nil");
+        std::string moved = model.ints[other];
+        t.set(key, t.get(other));
+        model.set(key, moved);
+        break;
+      }
+      case 5:
+      {
+        model.ints.emplace(other, "nil");
+        std::string moved = model.ints[other];
+        t.insert(t.get(other));
+        model.set(model.len() + 1, moved);
+        break;
+      }
+      case 6:
+      {
+        std::string from = name();
+        std::string to = name();
+        model.strings.emplace(from, "nil");
+        std::string moved = model.strings[from];
+        t.set(to, t.get(from));
+        model.set(to, moved);
+        break;
+      }
+      case 7:
+      {
+        Value copy = t;
+        t = Value::table();
+        t = copy;
+        break;
+      }
+      default:
+      {
+        Value moved = std::move(t);
+        t = std::move(moved);
+        break;
+      }
+      }
+
+      CHECK(t.len() == model.len());
+      std::string expected = model.serialize();
+      std::string actual = t.serialize();
+      if (actual != expected)
+      {
+        std::cerr << "round " << round << " step " << step << "\n  expected " << expected << "\n  actual   " << actual << "\n";
+        CHECK(actual == expected);
+        return TEST_RESULT();
+      }
+    }
+  }
+
+  return TEST_RESULT();
+}
@@ -0,0 +1,65 @@
+// Micro benchmark of the ansi escape sequence encoders
+//
+//   ansi_bench [FRAMES]
+//
+// Renders a full 160x50 screen where every cell changes color, the worst case for the
+// terminal renderer, into a reused output string as AnsiEscapeTerm does, and reports the
+// rendering throughput. Half of the colors are indexed and half are true color (palette).
+#include "drivers/ansi.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+using std::cout;
+using std::string;
+using std::chrono::duration;
+using std::chrono::steady_clock;
+
+static const int width = 160;
+static const int height = 50;
+
+int main(int argc, char** argv)
+{
+  int frames = argc > 1 ? std::atoi(argv[1]) : 2000;
+  if (frames <= 0)
+  {
+    std::cerr << "ansi_bench [FRAMES]\n";
+    return 1;
+  }
+
+  string out;
+  size_t bytes = 0;
+  size_t checksum = 0;
+
+  auto start = steady_clock::now();
+  for (int frame = 0; frame < frames; frame++)
+  {
+    out.clear();
+    for (int y = 1; y <= height; y++)
+    {
+      Ansi::append_pos(out, 1, y);
+      for (int x = 1; x <= width; x++)
+      {
+        uint32_t a = (x * 7 + y * 13 + frame) & 0xFF;
+        uint32_t b = Ansi::true_color | (a * 0x010101);
+        bool odd = (x + y + frame) & 1;
+        Ansi::append_color(out, odd ? a : b, odd ? b : a);
+        out += static_cast<char>('a' + x % 26);
+      }
+    }
+    bytes += out.size();
+    checksum += static_cast<unsigned char>(out[out.size() / 2]);
+  }
+  double seconds = duration<double>(steady_clock::now() - start).count();
+
+  cout << frames << " frames of " << width << "x" << height << " cells, "
+       << bytes / frames << " bytes per frame\n";
+  cout << "encoding: " << seconds << "s, "
+       << frames / seconds << " frames/s, "
+       << bytes / seconds / 1024 / 1024 << " MiB/s"
+       << " (checksum " << checksum << ")\n";
+  return 0;
+}
@@ -0,0 +1,164 @@
+// Packs a directory into a read only filesystem image for ocvm
+//
+//   mkimage DIR IMAGE      e.g. mkimage system/loot/openos openos.img
+//
+// A filesystem whose source uri names the image serves the tree from it, see drivers/image_format.h
+#include "drivers/image_format.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <experimental/filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+#include <sys/stat.h>
+#include <tuple>
+#include <vector>
+
+namespace fs = std::experimental::filesystem;
+using namespace ImageFormat;
+using std::cerr;
+using std::string;
+using std::vector;
+
+struct Item
+{
+  string dir; // relative to the root, no leading or trailing slash
+  string name;
+  string hostpath;
+  bool directory;
+  uint64_t size;
+  uint64_t modified;
+};
+
+static void usage()
+{
+  cerr << "mkimage DIR IMAGE\n";
+  ::exit(1);
+}
+
+static void scan(const string& hostdir, const string& dir, vector<Item>* items)
+{
+  for (const auto& entry : fs::directory_iterator(hostdir))
+  {
+    string hostpath = entry.path().string();
+    struct stat st;
+    if (::stat(hostpath.c_str(), &st) != 0)
+    {
+      cerr << "skipped " << hostpath << ": " << std::strerror(errno) << "\n";
+      continue;
+    }
+
+    Item item;
+    item.dir = dir;
+    item.name = entry.path().filename().string();
+    item.hostpath = hostpath;
+    item.directory = S_ISDIR(st.st_mode);
+    item.size = S_ISREG(st.st_mode) ? st.st_size : 0;
+    item.modified = st.st_mtime;
+    if (!item.directory && !S_ISREG(st.st_mode))
+    {
+      cerr << "skipped " << hostpath << ": not a file or directory\n";
+      continue;
+    }
+    items->push_back(item);
+
+    if (item.directory)
+      scan(hostpath, dir.empty() ? item.name : dir + "/" + item.name, items);
+  }
+}
+
+int main(int argc, char** argv)
+{
+  if (argc != 3)
+    usage();
+
+  string root = argv[1];
+  if (!fs::is_directory(root))
+  {
+    cerr << root << " is not a directory\n";
+    return 1;
+  }
+
+  vector<Item> items;
+  scan(root, "", &items);
+  std::sort(items.begin(), items.end(), [](const Item& a, const Item& b) {
+    return std::tie(a.dir, a.name) < std::tie(b.dir, b.name);
+  });
+
+  // each distinct string is stored once, a directory's path is shared by all its entries
+  string names;
+  std::map<string, uint32_t> offsets;
+  auto intern = [&](const string& text) {
+    auto it = offsets.find(text);
+    if (it != offsets.end())
+      return it->second;
+    uint32_t offset = static_cast<uint32_t>(names.size());
+    names += text;
+    offsets[text] = offset;
+    return offset;
+  };
+
+  // files are laid out in index order, the files of a directory end up next to each other
+  vector<ImageEntry> entries;
+  uint64_t data_size = 0;
+  for (const auto& item : items)
+  {
+    ImageEntry entry {};
+    entry.dir = intern(item.dir);
+    entry.dir_size = static_cast<uint32_t>(item.dir.size());
+    entry.name = intern(item.name);
+    entry.name_size = static_cast<uint32_t>(item.name.size());
+    entry.flags = item.directory ? Directory : 0;
+    entry.offset = data_size;
+    entry.size = item.size;
+    entry.modified = item.modified;
+    entries.push_back(entry);
+    data_size += item.size;
+  }
+
+  ImageHeader header {};
+  std::memcpy(header.magic, ImageFormat::magic, sizeof(header.magic));
+  header.entries = static_cast<uint32_t>(entries.size());
+  header.names_size = static_cast<uint32_t>(names.size());
+  uint64_t names_end = sizeof(header) + entries.size() * sizeof(ImageEntry) + names.size();
+  header.data_offset = (names_end + 7) & ~uint64_t(7);
+  header.data_size = data_size;
+
+  std::ofstream out(argv[2], std::ios::binary | std::ios::trunc);
+  if (!out)
+  {
+    cerr << "could not create " << argv[2] << "\n";
+    return 1;
+  }
+  out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  out.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(ImageEntry));
+  out.write(names.data(), names.size());
+  out.write("\0\0\0\0\0\0\0", header.data_offset - names_end);
+
+  vector<char> buffer;
+  for (const auto& item : items)
+  {
+    if (item.directory)
+      continue;
+
+    std::ifstream in(item.hostpath, std::ios::binary);
+    buffer.resize(item.size);
+    if (!in.read(buffer.data(), buffer.size()))
+    {
+      cerr << "could not read " << item.hostpath << "\n";
+      return 1;
+    }
+    out.write(buffer.data(), buffer.size());
+  }
+
+  if (!out.flush())
+  {
+    cerr << "could not write " << argv[2] << "\n";
+    return 1;
+  }
+  std::cout << entries.size() << " entries, " << data_size << " bytes\n";
+  return 0;
+}
@@ -0,0 +1,218 @@
+// Offline reader for the allocation profiles written by ocvm --log-allocs
+//
+//   prof_report PROFILE                  per callsite report: live bytes, peak live bytes, allocated bytes
+//   prof_report PROFILE --folded         folded stacks of allocated bytes (for flamegraph.pl)
+//   prof_report PROFILE --folded-live    folded stacks of the bytes still live at the end of the profile
+//
+// The profile samples allocations, byte counts are estimates scaled by the sample weights
+#include "model/prof_format.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace ProfFormat;
+using std::cerr;
+using std::cout;
+using std::string;
+using std::unordered_map;
+using std::vector;
+
+struct Stack
+{
+  vector<string> frames; // innermost first
+  string callsite;
+  uint64_t allocated = 0;
+  uint64_t live = 0;
+};
+
+struct Callsite
+{
+  uint64_t allocated = 0;
+  uint64_t live = 0;
+  uint64_t peak = 0;
+  uint64_t samples = 0;
+};
+
+struct LiveBlock
+{
+  uint32_t stack;
+  uint64_t weight;
+};
+
+static void usage()
+{
+  cerr << "prof_report PROFILE [--folded | --folded-live]\n";
+  ::exit(1);
+}
+
+static string trim(const string& text)
+{
+  size_t first = text.find_first_not_of(" \t\r");
+  if (first == string::npos)
+    return "";
+  size_t last = text.find_last_not_of(" \t\r");
+  return text.substr(first, last - first + 1);
+}
+
+// the stack text is a lua traceback, one frame per line after the "stack traceback:" header
+static Stack parse_stack(const string& text)
+{
+  Stack stack;
+  std::istringstream lines(text);
+  string line;
+  while (std::getline(lines, line))
+  {
+    line = trim(line);
+    if (line.empty() || line == "stack traceback:")
+      continue;
+    // ';' separates frames in the folded format
+    std::replace(line.begin(), line.end(), ';', ',');
+    stack.frames.push_back(line);
+    if (stack.callsite.empty() && line.find("[C]") != 0)
+      stack.callsite = line;
+  }
+
+  if (stack.callsite.empty())
+    stack.callsite = stack.frames.empty() ? "[unknown]" : stack.frames.front();
+  if (stack.frames.empty())
+    stack.frames.push_back("[unknown]");
+  return stack;
+}
+
+static string pretty(uint64_t bytes)
+{
+  std::ostringstream ss;
+  if (bytes >= 1024 * 1024)
+    ss << (bytes / 1024.0 / 1024.0) << "M";
+  else if (bytes >= 1024)
+    ss << (bytes / 1024.0) << "K";
+  else
+    ss << bytes;
+  return ss.str();
+}
+
+int main(int argc, char** argv)
+{
+  if (argc < 2 || argc > 3)
+    usage();
+
+  string mode = argc == 3 ? argv[2] : "";
+  if (!mode.empty() && mode != "--folded" && mode != "--folded-live")
+    usage();
+
+  FILE* file = fopen(argv[1], "rb");
+  if (!file)
+  {
+    cerr << "could not open " << argv[1] << "\n";
+    return 1;
+  }
+
+  ProfHeader header;
+  if (fread(&header, sizeof(header), 1, file) != 1 || std::memcmp(header.magic, magic, sizeof(magic)) != 0)
+  {
+    cerr << argv[1] << " is not an ocvm allocation profile\n";
+    return 1;
+  }
+
+  unordered_map<uint32_t, Stack> stacks;
+  std::map<string, Callsite> callsites;
+  unordered_map<uint64_t, LiveBlock> live;
+  uint64_t records = 0;
+
+  ProfRecord rec;
+  while (fread(&rec, sizeof(rec), 1, file) == 1)
+  {
+    records++;
+    if (rec.kind == StackRecord)
+    {
+      string text(rec.size, '\0');
+      if (rec.size && fread(&text[0], 1, rec.size, file) != rec.size)
+        break;
+      stacks[rec.stack] = parse_stack(text);
+    }
+    else if (rec.kind == AllocRecord)
+    {
+      auto sit = stacks.find(rec.stack);
+      if (sit == stacks.end())
+        continue;
+      Stack& stack = sit->second;
+      Callsite& site = callsites[stack.callsite];
+
+      // a block can be reported again if its free was not sampled (e.g. realloc in place)
+      auto lit = live.find(rec.ptr);
+      if (lit != live.end())
+      {
+        Stack& old = stacks[lit->second.stack];
+        old.live -= lit->second.weight;
+        callsites[old.callsite].live -= lit->second.weight;
+      }
+
+      live[rec.ptr] = { rec.stack, rec.weight };
+      stack.allocated += rec.weight;
+      stack.live += rec.weight;
+      site.allocated += rec.weight;
+      site.live += rec.weight;
+      site.peak = std::max(site.peak, site.live);
+      site.samples++;
+    }
+    else if (rec.kind == FreeRecord)
+    {
+      auto lit = live.find(rec.ptr);
+      if (lit == live.end())
+        continue;
+      Stack& stack = stacks[lit->second.stack];
+      stack.live -= lit->second.weight;
+      callsites[stack.callsite].live -= lit->second.weight;
+      live.erase(lit);
+    }
+    else
+    {
+      cerr << "corrupt record " << records << "\n";
+      break;
+    }
+  }
+  fclose(file);
+
+  if (!mode.empty())
+  {
+    bool bLive = mode == "--folded-live";
+    for (const auto& pair : stacks)
+    {
+      const Stack& stack = pair.second;
+      uint64_t bytes = bLive ? stack.live : stack.allocated;
+      if (bytes == 0)
+        continue;
+      // folded stacks are root first
+      for (auto it = stack.frames.rbegin(); it != stack.frames.rend(); ++it)
+      {
+        if (it != stack.frames.rbegin())
+          cout << ";";
+        cout << *it;
+      }
+      cout << " " << bytes << "\n";
+    }
+    return 0;
+  }
+
+  vector<std::pair<string, Callsite>> sorted(callsites.begin(), callsites.end());
+  std::sort(sorted.begin(), sorted.end(), [](const auto& a, const auto& b) {
+    return a.second.peak > b.second.peak;
+  });
+
+  cout << "sampled 1 per " << header.sample_bytes << " bytes, " << stacks.size() << " stacks, " << records << " records\n";
+  cout << "live\tpeak\tallocated\tsamples\tcallsite\n";
+  for (const auto& pair : sorted)
+  {
+    const Callsite& site = pair.second;
+    cout << pretty(site.live) << "\t" << pretty(site.peak) << "\t" << pretty(site.allocated) << "\t" << site.samples << "\t" << pair.first << "\n";
+  }
+
+  return 0;
+}
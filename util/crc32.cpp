@@ -67,12 +67,12 @@ static uint32_t crcLookupTable[] = {
   0xB40BBE37, 0xC30C8EA1, 0x5A05DF1B, 0x2D02EF8D
 };
 
-uint32_t util::crc32(vector<char> data)
+uint32_t util::crc32(std::string_view data)
 {
   uint32_t crc = 0xFFFFFFFF;
-  for (vector<char>::iterator i = data.begin(); i != data.end(); i++)
+  for (char c : data)
   {
-    uint8_t lookupIndex = (crc ^ *i) & 0xFF;
+    uint8_t lookupIndex = (crc ^ c) & 0xFF;
     crc = (crc >> 8) ^ crcLookupTable[lookupIndex];
   }
 
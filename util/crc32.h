@@ -1,9 +1,8 @@
 #pragma once
 #include <cstdint>
-#include <vector>
-using std::vector;
+#include <string_view>
 
 namespace util
 {
-uint32_t crc32(vector<char> data);
+uint32_t crc32(std::string_view data);
 }
\ No newline at end of file
@@ -29,8 +29,13 @@ static uint32_t K[64] =
 };
 // clang-format on
 
-vector<char> util::md5(vector<char> message)
+vector<char> util::md5(std::string_view input)
 {
+  // the padded copy is the only copy of the input
+  vector<char> message;
+  message.reserve(input.size() + 72);
+  message.assign(input.begin(), input.end());
+
   auto originalLength = (message.size() * 8) % 0x8000000000000000;
 
   message.push_back(0x80);
@@ -1,7 +1,8 @@
 #pragma once
+#include <string_view>
 #include <vector>
 
 namespace util
 {
-std::vector<char> md5(std::vector<char> input);
+std::vector<char> md5(std::string_view input);
 };